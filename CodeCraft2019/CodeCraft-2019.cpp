@@ -4,12 +4,15 @@
 
 #include "assert.h"
 #include "timer.h"
+#include "profiler.h"
+#include "deadline.h"
 #include "simulator.h"
 #include "sim-scenario.h"
 
 #include <list>
 #include <set>
 #include <map>
+#include <cstdlib>
 #include "random.h"
 #include "score-calculator.h"
 #include "map-generator.h"
@@ -24,7 +27,7 @@
 class Program
 {
 private:
-    int RunImpl(int argc, char *argv[], Scheduler* scheduler, bool save)
+    int RunImpl(int argc, char *argv[], Scheduler* scheduler, bool save, const CancelToken& token)
     {
         //Random::SetSeedAuto();
         Random::SetSeed(0);
@@ -35,11 +38,19 @@ private:
 
         SimScenario scenario;
         Simulator::Instance.SetScheduler(scheduler);
+        scheduler->SetCancelToken(&token);
         scheduler->Initialize(scenario);
         int time = 0;
+        bool isCancelled = false;
         for(; true; ++time) //forever until complete!
         {
             scheduler->Update(time, scenario);
+            if (!isCancelled && token.IsCancelled())
+            {
+                //no answer saved yet, the scheduler stops recomputing and we finish with the traces we have
+                isCancelled = true;
+                LOG("out of time at " << time << ", finish the run without recomputing");
+            }
             Simulator::UpdateResult result;
             if (false)
             {
@@ -83,7 +94,9 @@ public:
         Log::Enable<DeadLockSolver>();
         Log::Enable<Simulator>();
         Log::Enable<Timer>();
+        Log::Enable<Profiler>();
         Log::Enable<SchedulerTimeWeight>();
+        Log::Enable<RecomputeGate>();
         //Log::Disable<LoadState>();
 
         char* set1[] = { "", "./config2-1/car.txt", "./config2-1/road.txt", "./config2-1/cross.txt", "./config2-1/presetAnswer.txt", "./config2-1/answer.txt" };
@@ -110,15 +123,30 @@ public:
         scheduler.SetIsOptimalForLastVipCar(true);
         scheduler.SetIsVipCarDispatchFree(false);
         scheduler.SetPresetVipTracePreloadWeight(0.3);
+        scheduler.SetRecomputeDeltaThreshold(0.002);
+        scheduler.SetRecomputeMaxInterval(20);
 
         //SchedulerTimeWeight scheduler;
         //SchedulerAnswer scheduler;
 
-        scheduler.EnableTrace("log.tr");
-        int ret = RunImpl(argc, argv, &scheduler, true);
+        Deadline deadline;
+        deadline.Start(900);
+        deadline.SetPhaseBudget(Deadline::FINAL_SAVE, 120); //finishing a cancelled run without recomputing, about 90s on config2-1
+        CancelToken token(deadline.GetPhaseEnd(Deadline::SEARCH));
+
+        scheduler.EnableTrace("log.trb");
+        TickMetricsWriter::Format metricsFormat;
+        const char* metrics = getenv("TICK_METRICS"); //[csv] or [json]
+        if (metrics != 0 && TickMetricsWriter::ParseFormat(metrics, metricsFormat))
+            scheduler.EnableMetrics(metricsFormat == TickMetricsWriter::CSV ? "log.metrics.csv" : "log.metrics.json", metricsFormat);
+        if (getenv("PROFILE") != 0) //off by default, the zones cost time in the real run
+            Profiler::SetEnable(true);
+        //Profiler::SetRecordEvents(1 << 20);
+        int ret = RunImpl(argc, argv, &scheduler, true, token);
         LOG(ret);
 
-        Timer::Print();
+        Profiler::Print();
+        //Profiler::SaveChromeTrace("profile.json");
         return 0;
     }
 
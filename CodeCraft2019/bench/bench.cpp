@@ -0,0 +1,498 @@
+#include "config.h"
+#include "scenario.h"
+#include "sim-scenario.h"
+#include "simulator.h"
+#include "score-calculator.h"
+#include "scheduler-floyd.h"
+#include "scheduler-time-weight.h"
+#include "scheduler-answer.h"
+#include "deadline.h"
+#include "random.h"
+#include "async-writer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/*
+ * runs a scheduler, then a replay of an answer through SchedulerAnswer, over datasets (config* directories)
+ *   one JSON object for each line and run : dataset, run, status, times of phases in ms, ticks, ticks per second,
+ *   peak RSS, roll backs & score, so a baseline written before can be diffed by --baseline
+ *   scenario, simulator & tactics are singletons, so each run is in a forked process on linux,
+ *   which also makes the peak RSS of a run its own; other platforms run them in this process
+ *   the replay reads answer.txt of the dataset if it exists, or the answer written by the scheduler run
+ *   answers & scenario caches are written to a scratch directory, datasets are never touched
+ */
+class Bench
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static const double MinComparedMs; //throughput of shorter runs is noise
+
+    std::string m_root;
+    std::string m_scratch; //answers & caches of runs
+    std::string m_scheduler;
+    bool m_isReplay;
+    double m_budget; //seconds for each run, [<=0] means no limit
+    double m_tolerance; //ratio of ticks per second a run may lose against the baseline
+    std::vector<std::string> m_datasets;
+    std::vector<std::string> m_baseline; //lines of the baseline
+    FILE* m_output;
+
+    static double GetMs(const Clock::time_point& start, const Clock::time_point& end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    static bool IsFileExist(const std::string& file)
+    {
+        FILE* f = fopen(file.c_str(), "rb");
+        if (f == 0)
+            return false;
+        fclose(f);
+        return true;
+    }
+
+    static long GetPeakRssKb()
+    {
+#if defined(__linux__)
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            return usage.ru_maxrss;
+#endif
+        return -1;
+    }
+
+    static std::string MakeStatusLine(const std::string& dataset, const std::string& run, const char* status)
+    {
+        char line[512];
+        snprintf(line, sizeof(line), "{\"dataset\":\"%s\",\"run\":\"%s\",\"status\":\"%s\"}", dataset.c_str(), run.c_str(), status);
+        return line;
+    }
+
+    /* value of [key] in a line written by this tool, quotes of strings are removed */
+    static bool FindField(const std::string& line, const char* key, std::string& value)
+    {
+        std::string pattern = std::string("\"") + key + "\":";
+        std::size_t begin = line.find(pattern);
+        if (begin == std::string::npos)
+            return false;
+        begin += pattern.length();
+        std::size_t end = line.find_first_of(",}", begin);
+        if (end == std::string::npos)
+            return false;
+        value = line.substr(begin, end - begin);
+        if (value.length() >= 2 && value[0] == '"')
+            value = value.substr(1, value.length() - 2);
+        return true;
+    }
+
+    Scheduler* CreateScheduler(const std::string& run) const
+    {
+        if (run == "replay")
+            return new SchedulerAnswer();
+        if (run == "time-weight")
+        {
+            SchedulerTimeWeight* scheduler = new SchedulerTimeWeight();
+            scheduler->SetRecomputeDeltaThreshold(0.02);
+            scheduler->SetRecomputeMaxInterval(50);
+            return scheduler;
+        }
+        if (run != "floyd")
+            return 0;
+        //same arguments as Program::Run
+        SchedulerFloyd* scheduler = new SchedulerFloyd();
+        scheduler->SetLengthWeight(1.6);
+        scheduler->SetIsDropBackByDijkstra(false);
+        scheduler->SetIsEnableVipWeight(true);
+        scheduler->SetIsFasterAtEndStep(true);
+        scheduler->SetIsLessCarAfterDeadLock(false);
+        scheduler->SetIsLimitedByRoadSizeCount(true);
+        scheduler->SetIsOptimalForLastVipCar(true);
+        scheduler->SetIsVipCarDispatchFree(false);
+        scheduler->SetPresetVipTracePreloadWeight(0.3);
+        scheduler->SetRecomputeDeltaThreshold(0.002);
+        scheduler->SetRecomputeMaxInterval(20);
+        return scheduler;
+    }
+
+    /* one run in this process, return its line */
+    std::string RunImpl(const std::string& dataset, const std::string& run, const std::string& answer)
+    {
+        std::string dir = m_root + "/" + dataset + "/";
+        std::string paths[6] = { "", dir + "car.txt", dir + "road.txt", dir + "cross.txt", dir + "presetAnswer.txt", answer };
+        char* args[6];
+        for (int i = 0; i < 6; ++i)
+            args[i] = &paths[i][0];
+        Random::SetSeed(0);
+        Config::Initialize(6, args);
+        Config::PathCache = m_scratch + "/" + dataset + ".cache";
+
+        Clock::time_point start = Clock::now();
+        Scenario::Initialize();
+        SimScenario scenario;
+        Clock::time_point loaded = Clock::now();
+
+        Scheduler* scheduler = CreateScheduler(run);
+        if (scheduler == 0)
+            return MakeStatusLine(dataset, run, "unknown_scheduler");
+        CancelToken unlimited;
+        CancelToken limited(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_budget)));
+        const CancelToken& token = m_budget > 0 ? limited : unlimited;
+        Simulator::SetEnableCheater(true); //disabled by SchedulerAnswer
+        Simulator::Instance.SetScheduler(scheduler);
+        scheduler->SetCancelToken(&token);
+        scheduler->Initialize(scenario);
+        Clock::time_point initialized = Clock::now();
+
+        double scheduleMs = 0, simulateMs = 0, resultMs = 0;
+        int ticks = 0;
+        int rollbacks = 0;
+        const char* status = "ok";
+        int time = 0;
+        for (; true; ++time)
+        {
+            Clock::time_point t0 = Clock::now();
+            scheduler->Update(time, scenario);
+            Clock::time_point t1 = Clock::now();
+            scheduleMs += GetMs(t0, t1);
+            if (token.IsCancelled())
+            {
+                status = "cancelled";
+                break;
+            }
+            Simulator::UpdateResult result = Simulator::Instance.Update(time, scenario);
+            Clock::time_point t2 = Clock::now();
+            simulateMs += GetMs(t1, t2);
+            ++ticks;
+            int oldTime = time;
+            scheduler->HandleResult(time, scenario, result);
+            resultMs += GetMs(t2, Clock::now());
+            if (time < oldTime)
+                ++rollbacks;
+            if (result.Conflict)
+            {
+                status = "conflict";
+                break;
+            }
+            if (scenario.IsComplete())
+                break;
+        }
+        Clock::time_point simulated = Clock::now();
+
+        int score = -1;
+        if (strcmp(status, "ok") == 0)
+        {
+            score = Scenario::GetVipCarsN() > 0 ? ScoreCalculator::Calculate(scenario).Score : time;
+            if (run != "replay")
+                scenario.SaveToFile();
+        }
+        Clock::time_point end = Clock::now();
+        delete scheduler;
+        Simulator::Instance.SetScheduler(0);
+
+        double runMs = GetMs(initialized, simulated);
+        char line[1024];
+        snprintf(line, sizeof(line),
+            "{\"dataset\":\"%s\",\"run\":\"%s\",\"status\":\"%s\","
+            "\"load_ms\":%.1f,\"initialize_ms\":%.1f,\"schedule_ms\":%.1f,\"simulate_ms\":%.1f,\"result_ms\":%.1f,"
+            "\"finish_ms\":%.1f,\"total_ms\":%.1f,\"ticks\":%d,\"ticks_per_s\":%.2f,\"peak_rss_kb\":%ld,"
+            "\"rollbacks\":%d,\"end_time\":%d,\"score\":%d}",
+            dataset.c_str(), run.c_str(), status,
+            GetMs(start, loaded), GetMs(loaded, initialized), scheduleMs, simulateMs, resultMs,
+            GetMs(simulated, end), GetMs(start, end), ticks, runMs > 0 ? ticks * 1000.0 / runMs : 0.0, GetPeakRssKb(),
+            rollbacks, time, score);
+        return line;
+    }
+
+    /* one run isolated from the others, status [error] means an ASSERT, [crash] means the process died */
+    std::string Run(const std::string& dataset, const std::string& run, const std::string& answer)
+    {
+        fprintf(stderr, "bench %s %s\n", dataset.c_str(), run.c_str());
+        fflush(stderr);
+        fflush(m_output);
+#if defined(__linux__)
+        int fds[2];
+        if (pipe(fds) != 0)
+            return MakeStatusLine(dataset, run, "crash");
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(fds[0]);
+            std::string line;
+            try
+            {
+                line = RunImpl(dataset, run, answer);
+            }
+            catch (int)
+            {
+                line = MakeStatusLine(dataset, run, "error");
+            }
+            std::size_t written = 0;
+            while (written < line.length())
+            {
+                ssize_t n = write(fds[1], line.data() + written, line.length() - written);
+                if (n <= 0)
+                    break;
+                written += n;
+            }
+            close(fds[1]);
+            AsyncWriter::FlushAll(); //_exit skips the flush at exit; writers are opened in the child only, the parent never logs
+            _exit(0);
+        }
+        close(fds[1]);
+        std::string line;
+        char buffer[1024];
+        ssize_t n;
+        while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+            line.append(buffer, n);
+        close(fds[0]);
+        int childStatus = 0;
+        if (pid < 0 || waitpid(pid, &childStatus, 0) != pid || line.length() == 0)
+            return MakeStatusLine(dataset, run, "crash");
+        return line;
+#else
+        try
+        {
+            return RunImpl(dataset, run, answer);
+        }
+        catch (int)
+        {
+            return MakeStatusLine(dataset, run, "error");
+        }
+#endif
+    }
+
+    void FindDatasets()
+    {
+#if defined(__linux__)
+        DIR* dir = opendir(m_root.c_str());
+        if (dir == 0)
+            return;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != 0)
+        {
+            std::string name(entry->d_name);
+            if (name.compare(0, 6, "config") == 0 && IsFileExist(m_root + "/" + name + "/car.txt"))
+                m_datasets.push_back(name);
+        }
+        closedir(dir);
+        std::sort(m_datasets.begin(), m_datasets.end());
+#endif
+    }
+
+    bool LoadBaseline(const char* file)
+    {
+        FILE* f = fopen(file, "rb");
+        if (f == 0)
+            return false;
+        std::string line;
+        int c;
+        while ((c = fgetc(f)) != EOF)
+        {
+            if (c != '\n')
+            {
+                line.push_back((char)c);
+                continue;
+            }
+            if (line.length() > 0)
+                m_baseline.push_back(line);
+            line.clear();
+        }
+        if (line.length() > 0)
+            m_baseline.push_back(line);
+        fclose(f);
+        return true;
+    }
+
+    /* return false if the run is a regression against the baseline */
+    bool Compare(const std::string& line) const
+    {
+        std::string dataset, run, status;
+        FindField(line, "dataset", dataset);
+        FindField(line, "run", run);
+        FindField(line, "status", status);
+        for (unsigned int i = 0; i < m_baseline.size(); ++i)
+        {
+            std::string baseDataset, baseRun, baseStatus;
+            if (!FindField(m_baseline[i], "dataset", baseDataset) || baseDataset != dataset
+                || !FindField(m_baseline[i], "run", baseRun) || baseRun != run)
+                continue;
+            FindField(m_baseline[i], "status", baseStatus);
+            if (baseStatus != status)
+            {
+                fprintf(stderr, "%s %s %s : status %s, baseline %s\n", baseStatus == "ok" ? "REGRESSION" : "CHANGED",
+                    dataset.c_str(), run.c_str(), status.c_str(), baseStatus.c_str());
+                return baseStatus != "ok";
+            }
+            if (status != "ok")
+                return true;
+            std::string value, baseValue;
+            bool isPassed = true;
+            if (FindField(line, "score", value) && FindField(m_baseline[i], "score", baseValue) && value != baseValue)
+            {
+                fprintf(stderr, "REGRESSION %s %s : score %s, baseline %s\n", dataset.c_str(), run.c_str(), value.c_str(), baseValue.c_str());
+                isPassed = false;
+            }
+            if (FindField(m_baseline[i], "total_ms", baseValue) && atof(baseValue.c_str()) >= MinComparedMs
+                && FindField(line, "ticks_per_s", value) && FindField(m_baseline[i], "ticks_per_s", baseValue)
+                && atof(value.c_str()) < atof(baseValue.c_str()) * (1 - m_tolerance))
+            {
+                fprintf(stderr, "REGRESSION %s %s : ticks per second %s, baseline %s\n", dataset.c_str(), run.c_str(), value.c_str(), baseValue.c_str());
+                isPassed = false;
+            }
+            return isPassed;
+        }
+        return true; //new run
+    }
+
+    void Emit(const std::string& line)
+    {
+        fprintf(m_output, "%s\n", line.c_str());
+        fflush(m_output);
+    }
+
+    /* a new directory in /tmp if no scratch directory is given (the working directory on other platforms) */
+    bool MakeScratch()
+    {
+        if (m_scratch.length() > 0)
+            return true;
+#if defined(__linux__)
+        char dir[] = "/tmp/bench-XXXXXX";
+        if (mkdtemp(dir) == 0)
+            return false;
+        m_scratch = dir;
+#else
+        m_scratch = "."; //the working directory
+#endif
+        return true;
+    }
+
+public:
+    Bench()
+        : m_root("."), m_scheduler("floyd"), m_isReplay(true), m_budget(0), m_tolerance(0.1), m_output(stdout)
+    { }
+
+    static int Usage()
+    {
+        fprintf(stderr,
+            "usage : bench [options] [dataset ...]\n"
+            "  --root <dir>          : directory of datasets, every config* directory of it if no dataset is given\n"
+            "  --scratch <dir>       : directory for answers & scenario caches of runs, a new one in /tmp by default\n"
+            "  --scheduler <name>    : floyd (default) or time-weight\n"
+            "  --no-replay           : do not replay an answer through SchedulerAnswer\n"
+            "  --budget <seconds>    : cancel a run after it, no limit by default\n"
+            "  --output <file>       : JSON lines, stdout by default\n"
+            "  --baseline <file>     : output of a run before, exit with 1 on a regression\n"
+            "  --tolerance <ratio>   : ticks per second a run may lose against the baseline, 0.1 by default,\n"
+            "                          runs shorter than 1 second in the baseline are only compared by status & score\n");
+        return 2;
+    }
+
+    int Run(int argc, char* argv[])
+    {
+        const char* output = 0;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            bool hasValue = i + 1 < argc;
+            if (arg == "--no-replay")
+                m_isReplay = false;
+            else if (arg == "--root" && hasValue)
+                m_root = argv[++i];
+            else if (arg == "--scratch" && hasValue)
+                m_scratch = argv[++i];
+            else if (arg == "--scheduler" && hasValue)
+                m_scheduler = argv[++i];
+            else if (arg == "--budget" && hasValue)
+                m_budget = atof(argv[++i]);
+            else if (arg == "--output" && hasValue)
+                output = argv[++i];
+            else if (arg == "--tolerance" && hasValue)
+                m_tolerance = atof(argv[++i]);
+            else if (arg == "--baseline" && hasValue)
+            {
+                if (!LoadBaseline(argv[++i]))
+                {
+                    fprintf(stderr, "can not read baseline %s\n", argv[i]);
+                    return 2;
+                }
+            }
+            else if (arg.compare(0, 2, "--") == 0)
+                return Usage();
+            else
+                m_datasets.push_back(arg);
+        }
+        if (m_scheduler != "floyd" && m_scheduler != "time-weight")
+            return Usage();
+        if (m_datasets.size() == 0)
+            FindDatasets();
+        if (m_datasets.size() == 0)
+        {
+            fprintf(stderr, "no dataset in %s\n", m_root.c_str());
+            return Usage();
+        }
+        if (!MakeScratch())
+        {
+            fprintf(stderr, "can not make a scratch directory\n");
+            return 2;
+        }
+        fprintf(stderr, "bench scratch %s\n", m_scratch.c_str());
+        if (output != 0 && (m_output = fopen(output, "wb")) == 0)
+        {
+            fprintf(stderr, "can not write %s\n", output);
+            return 2;
+        }
+
+        bool isPassed = true;
+        for (unsigned int i = 0; i < m_datasets.size(); ++i)
+        {
+            const std::string& dataset = m_datasets[i];
+            std::string dir = m_root + "/" + dataset + "/";
+            //the first round of 2019 has no preset answers & no priorities of cars, which are not read by Scenario
+            if (!IsFileExist(dir + "presetAnswer.txt"))
+            {
+                Emit(MakeStatusLine(dataset, m_scheduler, "unsupported"));
+                continue;
+            }
+            std::string answer = m_scratch + "/" + dataset + "-answer.txt";
+            std::string line = Run(dataset, m_scheduler, answer);
+            isPassed = Compare(line) && isPassed;
+            Emit(line);
+            if (!m_isReplay)
+                continue;
+            std::string status;
+            FindField(line, "status", status);
+            if (IsFileExist(dir + "answer.txt"))
+                answer = dir + "answer.txt";
+            else if (status != "ok")
+                continue;
+            line = Run(dataset, "replay", answer);
+            isPassed = Compare(line) && isPassed;
+            Emit(line);
+        }
+        if (m_output != stdout)
+            fclose(m_output);
+        return isPassed ? 0 : 1;
+    }
+
+};//class Bench
+
+const double Bench::MinComparedMs = 1000;
+
+int main(int argc, char *argv[])
+{
+    Bench bench;
+    return bench.Run(argc, argv);
+}
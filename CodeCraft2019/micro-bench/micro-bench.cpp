@@ -0,0 +1,597 @@
+#include "config.h"
+#include "scenario.h"
+#include "scenario-cache.h"
+#include "file-reader.h"
+#include "sim-scenario.h"
+#include "simulator.h"
+#include "scheduler-floyd.h"
+#include "scheduler-time-weight.h"
+#include "tactics.h"
+#include "map-generator.h"
+#include "random.h"
+#include "define.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+/*
+ * state of one measurement, a kernel loops while KeepRunning() and may exclude its setup by PauseTiming()
+ *   the number of iterations is decided by MicroBench, so the kernel does not know it
+ */
+class MicroState
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    MicroState(const unsigned long long& iterations)
+        : m_iterations(iterations), m_count(0), m_elapsed(0), m_items(0), m_isRunning(false)
+    { }
+
+    inline bool KeepRunning()
+    {
+        if (m_count == 0)
+            ResumeTiming();
+        if (m_count == m_iterations)
+        {
+            PauseTiming();
+            return false;
+        }
+        ++m_count;
+        return true;
+    }
+
+    inline void PauseTiming()
+    {
+        if (m_isRunning)
+            m_elapsed += std::chrono::duration<double>(Clock::now() - m_start).count();
+        m_isRunning = false;
+    }
+
+    inline void ResumeTiming()
+    {
+        m_start = Clock::now();
+        m_isRunning = true;
+    }
+
+    inline void AddItems(const unsigned long long& n) { m_items += n; } //items processed, for items per second
+    inline const unsigned long long& GetIterations() const { return m_iterations; }
+    inline const double& GetElapsed() const { return m_elapsed; } //seconds
+    inline const unsigned long long& GetItems() const { return m_items; }
+
+private:
+    unsigned long long m_iterations;
+    unsigned long long m_count;
+    double m_elapsed;
+    unsigned long long m_items;
+    bool m_isRunning;
+    Clock::time_point m_start;
+
+};//class MicroState
+
+/*
+ * micro benchmarks of kernels of routing & simulation on maps of MapGenerator, one map for each size
+ *   the map of a size is generated, loaded & simulated for some ticks by SchedulerFloyd,
+ *   kernels of the simulator run on copies of that state without a scheduler,
+ *   so rerouting & garage dispatch are not measured with them
+ *   traces of cars are in Tactics, shared by all copies, so kernels rerouting cars restore them at the end
+ *   iterations grow until a measurement takes the minimum time, like google benchmark
+ */
+class MicroBench
+{
+private:
+    typedef void (MicroBench::*Kernel)(MicroState& state);
+
+    struct KernelCase
+    {
+        const char* Name;
+        Kernel Function;
+    };
+
+    static const KernelCase Cases[];
+    static const int CasesN;
+
+    /* options */
+    std::vector<int> m_sizes;
+    int m_carsPerCross;
+    int m_ticks;
+    double m_minTime;
+    std::string m_filter;
+    std::string m_work;
+    bool m_isWorkTemporary; //made by this run, removed with the files below at the end
+    std::vector<std::string> m_workFiles; //generated maps & the scenario cache
+    bool m_isJson;
+
+    /* fixture of the current size */
+    int m_size;
+    std::vector<std::string> m_files; //sections of ScenarioCache
+    unsigned long long m_hash;
+    SchedulerFloyd* m_scheduler;
+    SimScenario* m_populated; //after simulated some ticks
+    int m_time; //the last tick simulated
+    std::vector< std::vector<double> > m_weights; //floyd weights before relaxing
+    std::vector<int> m_onRoadCars; //cars can be routed by dijkstra
+    std::vector<Trace> m_traces; //Tactics of m_populated
+    std::vector<int> m_realTimes;
+    unsigned long long m_answerValuesN;
+
+    void RestoreTactics()
+    {
+        //assigned one by one, cars keep pointing to the same traces
+        Tactics::Instance.GetTraces() = m_traces;
+        Tactics::Instance.GetRealTimes() = m_realTimes;
+    }
+
+    /* kernels */
+    void FloydRelax(MicroState& state)
+    {
+        unsigned long long n = Scenario::Crosses().size();
+        while (state.KeepRunning())
+        {
+            m_scheduler->m_weightCrossToCross = m_weights; //O(n^2), small against the pass
+            m_scheduler->RelaxWeights(false);
+            state.AddItems(n * n * n);
+        }
+    }
+
+    void GetValidFirstHop(SimCar* car, std::vector<int>& validFirstHop) const
+    {
+        validFirstHop.clear();
+        Cross* cross = car->GetCurrentCross();
+        DirectionType_Foreach(dir,
+            Road* road = cross->GetRoad(dir);
+            if (road != 0 && road != car->GetCurrentRoad() && road->CanStartFrom(cross->GetId()))
+                validFirstHop.push_back(road->GetId());
+        );
+    }
+
+    void Dijkstra(MicroState& state)
+    {
+        SimScenario work(*m_populated);
+        unsigned int i = 0;
+        while (state.KeepRunning())
+        {
+            m_scheduler->UpdateCarTraceByDijkstra(m_time, work, work.Cars()[m_onRoadCars[i++ % m_onRoadCars.size()]]);
+            state.AddItems(1);
+        }
+        RestoreTactics();
+    }
+
+    /* reroute of a car at first priority as SchedulerTimeWeight does : remove its weight, search, add it again */
+    void TimeWeightDijkstra(MicroState& state)
+    {
+        SimScenario work(*m_populated);
+        SchedulerTimeWeight scheduler;
+        scheduler.Initialize(work);
+        scheduler.UpdateTimeWeight(m_time, work);
+        std::vector<int> baned(1);
+        unsigned int i = 0;
+        while (state.KeepRunning())
+        {
+            SimCar* car = work.Cars()[m_onRoadCars[i++ % m_onRoadCars.size()]];
+            baned[0] = car->GetCurrentRoad()->GetId();
+            scheduler.UpdateTimeWeightForEachCar(m_time, car, true);
+            scheduler.UpdateCarTraceByDijkstraWithTimeWeight(m_time, work, car, baned);
+            scheduler.UpdateTimeWeightForEachCar(m_time, car, false);
+            state.AddItems(1);
+        }
+        RestoreTactics();
+    }
+
+    void ScenarioCopy(MicroState& state)
+    {
+        while (state.KeepRunning())
+        {
+            SimScenario copy(*m_populated);
+            state.AddItems(copy.Cars().size());
+        }
+    }
+
+    void ScenarioAssign(MicroState& state)
+    {
+        SimScenario work(*m_populated);
+        while (state.KeepRunning())
+        {
+            work = *m_populated;
+            state.AddItems(work.Cars().size());
+        }
+    }
+
+    /* phase 1 of a tick : every lane once */
+    void UpdateCarsInLane(MicroState& state)
+    {
+        SimScenario work(*m_populated);
+        int time = m_time + 1;
+        while (state.KeepRunning())
+        {
+            state.PauseTiming();
+            work = *m_populated;
+            state.ResumeTiming();
+            for (unsigned int iRoad = 0; iRoad < work.Roads().size(); ++iRoad)
+            {
+                SimRoad* road = work.Roads()[iRoad];
+                int lanes = road->GetRoad()->GetLanes();
+                for (int i = 0; i < lanes * 2; ++i)
+                {
+                    bool opposite = i >= lanes;
+                    if (opposite && !road->GetRoad()->GetIsTwoWay())
+                        break;
+                    Simulator::UpdateCarsInLane(time, work, road, (i % lanes) + 1, opposite, false);
+                }
+            }
+            state.AddItems(work.GetOnRoadCarsN());
+        }
+    }
+
+    /* one schedule cycle over all crosses after phase 1, only calls of PassCrossOrJustForward are timed */
+    void PassCrossOrJustForward(MicroState& state)
+    {
+        Simulator& simulator = Simulator::Instance;
+        SimScenario work(*m_populated);
+        int time = m_time + 1;
+        Simulator::UpdateResult result;
+        while (state.KeepRunning())
+        {
+            state.PauseTiming();
+            work = *m_populated;
+            simulator.m_firstPriorities.resize(work.Roads().size());
+            for (unsigned int i = 0; i < work.Roads().size(); ++i)
+            {
+                SimRoad* road = work.Roads()[i];
+                Simulator::UpdateCarsInRoad(time, work, road);
+                simulator.m_firstPriorities[i].first = simulator.PeekFirstPriorityCarOnRoad(time, work, road, road->GetRoad()->GetEndCrossId(), result);
+                simulator.m_firstPriorities[i].second = road->GetRoad()->GetIsTwoWay() ? simulator.PeekFirstPriorityCarOnRoad(time, work, road, road->GetRoad()->GetStartCrossId(), result) : 0;
+            }
+            for (unsigned int iCross = 0; iCross < Scenario::Crosses().size(); ++iCross)
+            {
+                Cross* cross = Scenario::Crosses()[iCross];
+                for (int dir = (int)Cross::NORTH; dir <= (int)Cross::WEST; ++dir)
+                {
+                    int id = cross->GetRoadId((Cross::DirectionType)dir);
+                    if (id >= 0 && Scenario::Roads()[id]->CanReachTo(cross->GetId()))
+                    {
+                        SimRoad* road = work.Roads()[id];
+                        bool isFromOrTo = road->GetRoad()->IsFromOrTo(cross->GetId());
+                        SimCar* firstPriority = 0;
+                        while ((firstPriority = isFromOrTo ? simulator.m_firstPriorities[id].second : simulator.m_firstPriorities[id].first) != 0)
+                        {
+                            int lane = firstPriority->GetCurrentLane();
+                            bool opposite = !firstPriority->GetCurrentDirection();
+                            state.ResumeTiming();
+                            bool isScheduled = simulator.PassCrossOrJustForward(time, work, firstPriority, result);
+                            state.PauseTiming();
+                            state.AddItems(1);
+                            if (!isScheduled)
+                                break;
+                            Simulator::UpdateCarsInLane(time, work, road, lane, opposite, true);
+                            (isFromOrTo ? simulator.m_firstPriorities[id].second : simulator.m_firstPriorities[id].first)
+                                = simulator.PeekFirstPriorityCarOnRoad(time, work, road, cross->GetId(), result);
+                        }
+                    }
+                }
+            }
+            state.ResumeTiming();
+        }
+    }
+
+    void ParseScenario(MicroState& state)
+    {
+        while (state.KeepRunning())
+        {
+            ScenarioCache cache;
+            cache.Build(m_files, m_hash);
+            for (int i = 0; i < ScenarioCache::SECTIONS_N; ++i)
+                state.AddItems(cache.GetTuplesN((ScenarioCache::Section)i));
+        }
+    }
+
+    /* the mapped path used by ScenarioCache, over the preset answers */
+    bool HandleAnswerTuple(const int* argv, const int& argc)
+    {
+        m_answerValuesN += argc;
+        return true;
+    }
+
+    void ParseAnswer(MicroState& state)
+    {
+        FileReader reader(0); //threads as ScenarioCache
+        while (state.KeepRunning())
+        {
+            m_answerValuesN = 0;
+            reader.ReadTuples(m_files[ScenarioCache::PRESET].c_str(), Callback::Create(&MicroBench::HandleAnswerTuple, this));
+            state.AddItems(m_answerValuesN);
+        }
+    }
+
+    /* fixture */
+    bool Prepare(const int& size)
+    {
+        m_size = size;
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "/micro-%dx%d-", size, size);
+        std::string base = m_work + prefix;
+        std::string paths[6] = { "", base + "car.txt", base + "road.txt", base + "cross.txt", base + "preset.txt", base + "answer.txt" };
+        char* args[6];
+        for (int i = 0; i < 6; ++i)
+            args[i] = &paths[i][0];
+        m_workFiles.insert(m_workFiles.end(), paths + 1, paths + 6);
+        m_workFiles.push_back(ScenarioCache::GetPathNextTo(paths[1]));
+        Random::SetSeed(size);
+        MapGenerator generator;
+        generator.SetWidth(size);
+        generator.SetHeight(size);
+        generator.SetCarsN(size * size * m_carsPerCross);
+        generator.Generate(6, args); //also initializes Config
+        Scenario::Initialize();
+
+        m_files.assign(ScenarioCache::SECTIONS_N, std::string());
+        m_files[ScenarioCache::CARS] = Config::PathCar;
+        m_files[ScenarioCache::CROSSES] = Config::PathCross;
+        m_files[ScenarioCache::ROADS] = Config::PathRoad;
+        m_files[ScenarioCache::PRESET] = Config::PathPreset;
+        if (!ScenarioCache::HashFiles(m_files, m_hash))
+            return false;
+
+        //simulate some ticks for cars on road
+        SimScenario scenario;
+        m_scheduler = new SchedulerFloyd();
+        Simulator::Instance.SetScheduler(m_scheduler);
+        m_scheduler->Initialize(scenario);
+        m_time = 0;
+        for (int time = 0; time < m_ticks; ++time)
+        {
+            m_scheduler->Update(time, scenario);
+            Simulator::UpdateResult result = Simulator::Instance.Update(time, scenario);
+            m_scheduler->HandleResult(time, scenario, result);
+            m_time = time;
+            if (result.Conflict || scenario.IsComplete())
+                break;
+        }
+        Simulator::Instance.SetScheduler(0);
+        m_populated = new SimScenario(scenario);
+        m_traces = Tactics::Instance.GetTraces();
+        m_realTimes = Tactics::Instance.GetRealTimes();
+
+        m_onRoadCars.clear();
+        std::vector<int> validFirstHop;
+        for (unsigned int i = 0; i < m_populated->Cars().size(); ++i)
+        {
+            SimCar* car = m_populated->Cars()[i];
+            if (car->GetIsInGarage() || car->GetIsReachedGoal() || car->GetCurrentCross() == car->GetCar()->GetToCross())
+                continue;
+            GetValidFirstHop(car, validFirstHop);
+            if (validFirstHop.size() > 0)
+                m_onRoadCars.push_back(i);
+        }
+
+        unsigned int crossesN = Scenario::Crosses().size();
+        m_weights.assign(crossesN, std::vector<double>(crossesN, Inf));
+        for (unsigned int i = 0; i < Scenario::Roads().size(); ++i)
+        {
+            Road* road = Scenario::Roads()[i];
+            double weight = road->GetLength() * m_scheduler->m_lengthWeight + 1.0 / road->GetLanes();
+            m_weights[road->GetStartCrossId()][road->GetEndCrossId()] = weight;
+            if (road->GetIsTwoWay())
+                m_weights[road->GetEndCrossId()][road->GetStartCrossId()] = weight;
+        }
+        return m_onRoadCars.size() > 0;
+    }
+
+    void Release()
+    {
+        delete m_populated;
+        m_populated = 0;
+        delete m_scheduler;
+        m_scheduler = 0;
+    }
+
+    void Measure(const KernelCase& kernel)
+    {
+        unsigned long long iterations = 1;
+        while (true)
+        {
+            MicroState state(iterations);
+            (this->*kernel.Function)(state);
+            double elapsed = state.GetElapsed();
+            if (elapsed >= m_minTime || iterations >= 1000000000ULL)
+            {
+                Report(kernel, state);
+                return;
+            }
+            //grow like google benchmark : aim at 1.4 times the minimum time, at most 10 times each round
+            double multiplier = elapsed > 0 ? m_minTime * 1.4 / elapsed : 10;
+            if (multiplier > 10)
+                multiplier = 10;
+            unsigned long long next = (unsigned long long)(iterations * multiplier);
+            iterations = next > iterations ? next : iterations + 1;
+        }
+    }
+
+    void Report(const KernelCase& kernel, const MicroState& state) const
+    {
+        double nsPerIteration = state.GetElapsed() * 1e9 / state.GetIterations();
+        double itemsPerSecond = state.GetElapsed() > 0 ? state.GetItems() / state.GetElapsed() : 0;
+        if (m_isJson)
+        {
+            printf("{\"kernel\":\"%s\",\"size\":%d,\"crosses\":%d,\"cars\":%d,\"iterations\":%llu,\"ns_per_iteration\":%.1f,\"items_per_s\":%.1f}\n",
+                kernel.Name, m_size, (int)Scenario::Crosses().size(), (int)Scenario::Cars().size(),
+                state.GetIterations(), nsPerIteration, itemsPerSecond);
+        }
+        else
+        {
+            char name[96];
+            snprintf(name, sizeof(name), "%s/%dx%d", kernel.Name, m_size, m_size);
+            printf("%-40s %12llu %16.1f ns %16.1f items/s\n", name, state.GetIterations(), nsPerIteration, itemsPerSecond);
+        }
+        fflush(stdout);
+    }
+
+    /* a new directory in /tmp if no work directory is given (the working directory on other platforms) */
+    bool MakeWork()
+    {
+        if (m_work.length() > 0)
+            return true;
+#if defined(__linux__)
+        char dir[] = "/tmp/micro-bench-XXXXXX";
+        if (mkdtemp(dir) == 0)
+            return false;
+        m_work = dir;
+        m_isWorkTemporary = true;
+#else
+        m_work = "."; //the working directory
+#endif
+        return true;
+    }
+
+    void RemoveWork()
+    {
+        if (!m_isWorkTemporary)
+            return;
+        for (unsigned int i = 0; i < m_workFiles.size(); ++i)
+            remove(m_workFiles[i].c_str()); //some are never written
+#if defined(__linux__)
+        rmdir(m_work.c_str());
+#endif
+    }
+
+    int RunSizes()
+    {
+        for (unsigned int iSize = 0; iSize < m_sizes.size(); ++iSize)
+        {
+            try
+            {
+                if (!Prepare(m_sizes[iSize]))
+                {
+                    fprintf(stderr, "map %dx%d has no car to route\n", m_sizes[iSize], m_sizes[iSize]);
+                    Release();
+                    return 1;
+                }
+                for (int i = 0; i < CasesN; ++i)
+                    if (IsSelected(Cases[i]))
+                        Measure(Cases[i]);
+            }
+            catch (int)
+            {
+                fprintf(stderr, "assert failed with map %dx%d\n", m_sizes[iSize], m_sizes[iSize]);
+                Release();
+                return 1;
+            }
+            Release();
+        }
+        return 0;
+    }
+
+    bool IsSelected(const KernelCase& kernel) const
+    {
+        return m_filter.length() == 0 || strstr(kernel.Name, m_filter.c_str()) != 0;
+    }
+
+    static bool ParseSizes(const char* text, std::vector<int>& sizes)
+    {
+        sizes.clear();
+        while (*text != 0)
+        {
+            char* end = 0;
+            long size = strtol(text, &end, 10);
+            if (end == text || size < 2)
+                return false;
+            sizes.push_back((int)size);
+            text = *end == ',' ? end + 1 : end;
+        }
+        return sizes.size() > 0;
+    }
+
+public:
+    MicroBench()
+        : m_carsPerCross(30), m_ticks(60), m_minTime(0.5), m_isWorkTemporary(false), m_isJson(false)
+        , m_size(0), m_hash(0), m_scheduler(0), m_populated(0), m_time(0), m_answerValuesN(0)
+    {
+        m_sizes.push_back(8);
+        m_sizes.push_back(12);
+        m_sizes.push_back(16);
+    }
+
+    static int Usage()
+    {
+        fprintf(stderr,
+            "usage : micro-bench [options]\n"
+            "  --sizes <n,n,...>      : width & height of generated maps, 8,12,16 by default\n"
+            "  --cars-per-cross <n>   : 30 by default\n"
+            "  --ticks <n>            : ticks simulated before kernels of the simulator, 60 by default\n"
+            "  --min-time <seconds>   : minimum time of each measurement, 0.5 by default\n"
+            "  --filter <text>        : only kernels whose name contains it\n"
+            "  --work <dir>           : directory of generated maps & the scenario cache, kept after the run,\n"
+            "                           a new one in /tmp removed at the end by default\n"
+            "  --json                 : one JSON object for each line\n"
+            "kernels :\n");
+        for (int i = 0; i < CasesN; ++i)
+            fprintf(stderr, "  %s\n", Cases[i].Name);
+        return 2;
+    }
+
+    int Run(int argc, char* argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            bool hasValue = i + 1 < argc;
+            if (arg == "--json")
+                m_isJson = true;
+            else if (arg == "--sizes" && hasValue)
+            {
+                if (!ParseSizes(argv[++i], m_sizes))
+                    return Usage();
+            }
+            else if (arg == "--cars-per-cross" && hasValue)
+                m_carsPerCross = atoi(argv[++i]);
+            else if (arg == "--ticks" && hasValue)
+                m_ticks = atoi(argv[++i]);
+            else if (arg == "--min-time" && hasValue)
+                m_minTime = atof(argv[++i]);
+            else if (arg == "--filter" && hasValue)
+                m_filter = argv[++i];
+            else if (arg == "--work" && hasValue)
+                m_work = argv[++i];
+            else
+                return Usage();
+        }
+        if (m_carsPerCross <= 0 || m_ticks <= 0 || m_minTime <= 0)
+            return Usage();
+        if (!MakeWork())
+        {
+            fprintf(stderr, "can not make a work directory\n");
+            return 2;
+        }
+
+        int ret = RunSizes();
+        RemoveWork();
+        return ret;
+    }
+
+};//class MicroBench
+
+const MicroBench::KernelCase MicroBench::Cases[] =
+{
+    { "floyd.relax", &MicroBench::FloydRelax },
+    { "floyd.dijkstra", &MicroBench::Dijkstra },
+    { "time-weight.dijkstra", &MicroBench::TimeWeightDijkstra },
+    { "scenario.copy", &MicroBench::ScenarioCopy },
+    { "scenario.assign", &MicroBench::ScenarioAssign },
+    { "simulator.update-cars-in-lane", &MicroBench::UpdateCarsInLane },
+    { "simulator.pass-cross", &MicroBench::PassCrossOrJustForward },
+    { "parser.scenario", &MicroBench::ParseScenario },
+    { "parser.answer", &MicroBench::ParseAnswer }
+};
+const int MicroBench::CasesN = sizeof(MicroBench::Cases) / sizeof(MicroBench::Cases[0]);
+
+int main(int argc, char *argv[])
+{
+    MicroBench bench;
+    return bench.Run(argc, argv);
+}
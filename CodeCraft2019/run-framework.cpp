@@ -1,6 +1,7 @@
 #include "run-framework.h"
 #include "log.h"
 #include "timer.h"
+#include "deadline.h"
 #include "random.h"
 #include "config.h"
 #include "scenario.h"
@@ -8,14 +9,19 @@
 #include "sim-scenario.h"
 
 RunFramework::RunFramework()
-    : m_maxTime(900), m_safeInterval(100), m_bestAnswer(-1)
+    : m_bestAnswer(-1)
     , m_isStableOutputed(false)
     , m_floydLengthWeight(1.0), m_floydLooserCarsNumOnRoadLimit(0)
-{ }
+{
+    m_deadline.Start(900);
+    m_deadline.SetPhaseBudget(Deadline::STABLE_RUN, 300);
+    m_deadline.SetPhaseBudget(Deadline::SEARCH, -1); //all time left
+    m_deadline.SetPhaseBudget(Deadline::FINAL_SAVE, 100); //scoring & saving the last candidate
+}
 
 bool RunFramework::IsNoMoreTime() const
 {
-    return Timer::GetLeftTime(m_maxTime) < m_safeInterval;
+    return m_deadline.IsPhaseOver(Deadline::SEARCH);
 }
 
 void RunFramework::Run(int argc, char* argv[])
@@ -47,16 +53,22 @@ void RunFramework::Run(int argc, char* argv[])
 
 #include "score-calculator.h"
 
-void RunFramework::RunImpl(Scheduler* scheduler)
+void RunFramework::RunImpl(Scheduler* scheduler, const CancelToken& token)
 {
     Scenario::Reset();
     SimScenario scenario;
     Simulator::Instance.SetScheduler(scheduler);
+    scheduler->SetCancelToken(&token);
     scheduler->Initialize(scenario);
     int time = 0;
     for(; true; ++time) //forever until complete!
     {
         scheduler->Update(time, scenario);
+        if (token.IsCancelled() && m_bestAnswer >= 0)
+        {
+            LOG("run cancelled at time " << time << " " << m_deadline.GetSpendTime() << "s");
+            return;
+        }
         Simulator::UpdateResult result;
         if (false)
         {
@@ -76,10 +88,8 @@ void RunFramework::RunImpl(Scheduler* scheduler)
             return;
         if (scenario.IsComplete())
             break;
-        if (IsNoMoreTime())
-            return;
     }
-    LOG("Program execute time : " << Timer::GetSpendTime() << "s");
+    LOG("Program execute time : " << Timer::GetSpendTime() << "s, wall clock " << m_deadline.GetSpendTime() << "s");
     int answer = ScoreCalculator::Calculate(scenario).Score;
     if(m_bestAnswer < 0 || answer < m_bestAnswer)
     {
@@ -104,8 +114,7 @@ bool RunFramework::HandleTerminateAssert()
 
 void RunFramework::RunStableVersion()
 {
-    m_isStableOutputed = true;
-    return;
+    CancelToken token(m_deadline.GetPhaseEnd(Deadline::STABLE_RUN));
     SchedulerFloyd scheduler;
     scheduler.SetLengthWeight(m_floydLengthWeight);
     scheduler.SetIsDropBackByDijkstra(false);
@@ -116,13 +125,16 @@ void RunFramework::RunStableVersion()
     scheduler.SetIsOptimalForLastVipCar(true);
     scheduler.SetIsVipCarDispatchFree(false);
     scheduler.SetPresetVipTracePreloadWeight(0.3);
-    RunImpl(&scheduler);
+    scheduler.SetRecomputeDeltaThreshold(0.002);
+    scheduler.SetRecomputeMaxInterval(20);
+    RunImpl(&scheduler, token);
     m_isStableOutputed = true;
 }
 
 void RunFramework::RunFindABetterAnswer()
 {
-    for (int i = m_floydLooserCarsNumOnRoadLimit; !IsNoMoreTime(); i += 1000)
+    CancelToken token(m_deadline.GetPhaseEnd(Deadline::SEARCH));
+    for (int i = m_floydLooserCarsNumOnRoadLimit; !token.IsCancelled(); i += 1000)
     {
         SchedulerFloyd scheduler;
         scheduler.SetLengthWeight(m_floydLengthWeight);
@@ -134,7 +146,9 @@ void RunFramework::RunFindABetterAnswer()
         scheduler.SetIsOptimalForLastVipCar(true);
         scheduler.SetIsVipCarDispatchFree(false);
         scheduler.SetPresetVipTracePreloadWeight(0.3);
+        scheduler.SetRecomputeDeltaThreshold(0.002);
+        scheduler.SetRecomputeMaxInterval(20);
         scheduler.SetLooserCarsNumOnRoadLimit(i);
-        RunImpl(&scheduler);
+        RunImpl(&scheduler, token);
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define RUN_FRAMEWORK_H
 
 #include "scheduler.h"
+#include "deadline.h"
 
 /* for find a best answer */
 class RunFramework
@@ -11,7 +12,7 @@ public:
     void Initialize();
     bool HandleTerminateAssert();
     void Run(int argc, char* argv[]);
-    void RunImpl(Scheduler* scheduler);
+    void RunImpl(Scheduler* scheduler, const CancelToken& token); //dropped if cancelled, finished without recomputing if no answer yet
 
     //implements
     void RunStableVersion();
@@ -20,8 +21,7 @@ public:
 private:
     bool IsNoMoreTime() const;
 
-    double m_maxTime;
-    double m_safeInterval;
+    Deadline m_deadline; //wall clock, threads do not make it run faster
     int m_bestAnswer;
 
     //variables of implements
@@ -6,6 +6,7 @@ std::string Config::PathCross;
 std::string Config::PathRoad;
 std::string Config::PathPreset;
 std::string Config::PathResult;
+std::string Config::PathCache;
 const double Config::TimeLimit(900);
 
 Config::Config()
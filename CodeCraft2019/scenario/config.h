@@ -16,6 +16,7 @@ public:
     static std::string PathRoad;
     static std::string PathPreset;
     static std::string PathResult;
+    static std::string PathCache; //[empty] means scenario.cache next to the input files
     static const double TimeLimit;
     
 };//class Config
@@ -0,0 +1,179 @@
+#include "scenario-cache.h"
+#include "file-reader.h"
+#include "buffered-writer.h"
+#include "assert.h"
+#include <cstring>
+
+const int ScenarioCache::Magic(0x43534343); //"CCSC"
+const int ScenarioCache::Version(1);
+
+const int HeaderN = 5;
+
+ScenarioCache::ScenarioCache()
+    : m_data(0), m_size(0), m_isValid(false)
+{
+    Clear();
+}
+
+bool ScenarioCache::HashFiles(const std::vector<std::string>& files, unsigned long long& hash)
+{
+    //FNV-1a over the size and the content of every file
+    hash = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < files.size(); ++i)
+    {
+        MappedFile file;
+        if (!file.Open(files[i].c_str()))
+            return false;
+        unsigned long long size = file.GetSize();
+        for (int j = 0; j < 8; ++j)
+        {
+            hash ^= (size >> (j * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+        const unsigned char* p = (const unsigned char*)file.GetData();
+        const unsigned char* end = p + file.GetSize();
+        for (; p < end; ++p)
+        {
+            hash ^= *p;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return true;
+}
+
+std::string ScenarioCache::GetPathNextTo(const std::string& file)
+{
+    std::size_t slash = file.find_last_of("/\\");
+    return (slash == std::string::npos ? std::string() : file.substr(0, slash + 1)) + "scenario.cache";
+}
+
+bool ScenarioCache::Load(const std::string& path, const unsigned long long& hash)
+{
+    Clear();
+    if (!m_file.Open(path.c_str()))
+        return false;
+    if (m_file.GetSize() % sizeof(int) != 0 || !Attach((const int*)m_file.GetData(), m_file.GetSize() / sizeof(int), hash))
+    {
+        Clear();
+        return false;
+    }
+    return true;
+}
+
+/* tuples of one section, in the layout of cache */
+class SectionCollector
+{
+private:
+    std::vector<int>& m_offsets;
+    std::vector<int>& m_values;
+
+public:
+    SectionCollector(std::vector<int>& offsets, std::vector<int>& values)
+        : m_offsets(offsets), m_values(values)
+    {
+        m_offsets.assign(1, 0);
+    }
+
+    bool Add(const int* argv, const int& argc)
+    {
+        m_values.insert(m_values.end(), argv, argv + argc);
+        m_offsets.push_back(m_values.size());
+        return true;
+    }
+
+};//class SectionCollector
+
+bool ScenarioCache::Build(const std::vector<std::string>& files, const unsigned long long& hash)
+{
+    ASSERT(files.size() == SECTIONS_N);
+    Clear();
+    std::vector<int> offsets[SECTIONS_N];
+    std::vector<int> values[SECTIONS_N];
+    for (int i = 0; i < SECTIONS_N; ++i)
+    {
+        SectionCollector collector(offsets[i], values[i]);
+        if (!FileReader(0).ReadTuples(files[i].c_str(), Callback::Create(&SectionCollector::Add, &collector)))
+            return false;
+    }
+    m_built.push_back(Magic);
+    m_built.push_back(Version);
+    m_built.push_back((int)(hash & 0xffffffffULL));
+    m_built.push_back((int)(hash >> 32));
+    m_built.push_back(SECTIONS_N);
+    for (int i = 0; i < SECTIONS_N; ++i)
+    {
+        m_built.push_back(offsets[i].size() - 1);
+        m_built.push_back(values[i].size());
+    }
+    for (int i = 0; i < SECTIONS_N; ++i)
+    {
+        m_built.insert(m_built.end(), offsets[i].begin(), offsets[i].end());
+        m_built.insert(m_built.end(), values[i].begin(), values[i].end());
+    }
+    return Attach(&m_built[0], m_built.size(), hash);
+}
+
+bool ScenarioCache::Save(const std::string& path) const
+{
+    if (!m_isValid)
+        return false;
+    return BufferedWriter::CommitFile(path.c_str(), m_data, m_size * sizeof(int));
+}
+
+void ScenarioCache::Clear()
+{
+    m_file.Close();
+    std::vector<int>().swap(m_built);
+    m_data = 0;
+    m_size = 0;
+    m_isValid = false;
+    for (int i = 0; i < SECTIONS_N; ++i)
+    {
+        m_offsets[i] = 0;
+        m_values[i] = 0;
+        m_tuplesN[i] = 0;
+    }
+}
+
+void ScenarioCache::ForEach(const Section& section, const Callback::Handle2<bool, const int*, const int&>& callback) const
+{
+    ASSERT(m_isValid);
+    const int* offsets = m_offsets[section];
+    const int* values = m_values[section];
+    for (int i = 0; i < m_tuplesN[section]; ++i)
+        if (!callback.Invoke(values + offsets[i], offsets[i + 1] - offsets[i]))
+            break;
+}
+
+bool ScenarioCache::Attach(const int* data, const std::size_t& size, const unsigned long long& hash)
+{
+    std::size_t headerN = HeaderN + SECTIONS_N * 2;
+    if (size < headerN
+        || data[0] != Magic
+        || data[1] != Version
+        || data[2] != (int)(hash & 0xffffffffULL)
+        || data[3] != (int)(hash >> 32)
+        || data[4] != SECTIONS_N)
+        return false;
+    std::size_t position = headerN;
+    for (int i = 0; i < SECTIONS_N; ++i)
+    {
+        int tuplesN = data[HeaderN + i * 2];
+        int valuesN = data[HeaderN + i * 2 + 1];
+        if (tuplesN < 0 || valuesN < 0 || position + tuplesN + 1 + valuesN > size)
+            return false;
+        m_tuplesN[i] = tuplesN;
+        m_offsets[i] = data + position;
+        position += tuplesN + 1;
+        m_values[i] = data + position;
+        position += valuesN;
+        if (m_offsets[i][0] != 0 || m_offsets[i][tuplesN] != valuesN)
+            return false;
+    }
+    if (position != size)
+        return false;
+    m_data = data;
+    m_size = size;
+    m_isValid = true;
+    return true;
+}
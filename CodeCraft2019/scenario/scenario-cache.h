@@ -0,0 +1,87 @@
+#ifndef SCENARIO_CACHE_H
+#define SCENARIO_CACHE_H
+
+#include <vector>
+#include <string>
+#include "callback.h"
+#include "mapped-file.h"
+
+/*
+ * binary copy of the tuples parsed from input files, saved next to them
+ *   it is only used if the format version and the hash of all input files are matched
+ *   a loaded cache is mapped read only, tuples are handed out without any parsing
+ *
+ * layout (int array) :
+ *   magic, version, hash low, hash high, sections number
+ *   [tuples number, values number] of each section
+ *   [offsets (tuples number + 1), values] of each section
+ */
+class ScenarioCache
+{
+public:
+    enum Section
+    {
+        CARS = 0,
+        CROSSES,
+        ROADS,
+        PRESET,
+        SECTIONS_N
+    };
+
+    ScenarioCache();
+
+    /* hash of the files content, [false] if any of them can not be read */
+    static bool HashFiles(const std::vector<std::string>& files, unsigned long long& hash);
+    /* the cache file for inputs in the same directory of [file] */
+    static std::string GetPathNextTo(const std::string& file);
+
+    bool Load(const std::string& path, const unsigned long long& hash); //[false] means missing or stale
+    bool Build(const std::vector<std::string>& files, const unsigned long long& hash); //parse files of all sections in order
+    bool Save(const std::string& path) const; //write a temporary file then rename it, so a broken cache is never seen
+    void Clear();
+
+    inline const bool& GetIsValid() const;
+    inline int GetTuplesN(const Section& section) const;
+    /* invoke callback for tuples of the section in file order */
+    void ForEach(const Section& section, const Callback::Handle2<bool, const int*, const int&>& callback) const;
+
+private:
+    ScenarioCache(const ScenarioCache& o); //holds a mapping, not copyable
+    ScenarioCache& operator = (const ScenarioCache& o);
+
+    bool Attach(const int* data, const std::size_t& size, const unsigned long long& hash);
+
+    static const int Magic;
+    static const int Version;
+
+    MappedFile m_file;
+    std::vector<int> m_built; //data of a cache just built, used when it is not loaded from file
+    const int* m_data;
+    std::size_t m_size; //number of ints
+    bool m_isValid;
+    const int* m_offsets[SECTIONS_N];
+    const int* m_values[SECTIONS_N];
+    int m_tuplesN[SECTIONS_N];
+
+};//class ScenarioCache
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline const bool& ScenarioCache::GetIsValid() const
+{
+    return m_isValid;
+}
+
+inline int ScenarioCache::GetTuplesN(const Section& section) const
+{
+    return m_isValid ? m_tuplesN[section] : 0;
+}
+
+#endif
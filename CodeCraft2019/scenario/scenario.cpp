@@ -1,5 +1,4 @@
 #include "scenario.h"
-#include "file-reader.h"
 #include "assert.h"
 #include "config.h"
 #include "log.h"
@@ -29,100 +28,45 @@ Scenario::~Scenario()
     ClearVector(m_roads);
 }
 
-bool HandleIntStream(std::istream& is, int argc, int* argv)
+bool Scenario::HandleCar(const int* argv, const int& argc)
 {
-    char c;
-    is >> c;
-    if (c == '#')
-        return false;
-    if (c != '(')
-        ASSERT(false);
-    for (int i = 0; i < argc; ++i)
-    {
-        argv[i] = -1;
-        is >> argv[i] >> c;
-        ASSERT_MSG(c == (i == argc - 1 ? ')' : ','), "char=" << c << " position=" << i);
-    }
-    return true;
-}
-
-bool Scenario::HandleCar(std::istream& is)
-{
-    int argc = 7;
-    int* contents = new int[argc];
-    if (HandleIntStream(is, argc, contents))
-    {
-        int id = contents[0];
-        ASSERT(m_carsIndexMap.find(id) == m_carsIndexMap.end());
-        m_carsIndexMap[id] = m_cars.size();
-        m_cars.push_back(new Car(id, m_cars.size(), contents[1], contents[2], contents[3], contents[4], contents[5] == 1, contents[6] == 1));
-    }
-    delete[] contents;
+    ASSERT_MSG(argc == 7, "argc=" << argc);
+    int id = argv[0];
+    m_carsIndexer.Input(id, m_cars.size());
+    m_cars.push_back(new Car(id, m_cars.size(), argv[1], argv[2], argv[3], argv[4], argv[5] == 1, argv[6] == 1));
     return true;
 }
 
-bool Scenario::HandleCross(std::istream& is)
+bool Scenario::HandleCross(const int* argv, const int& argc)
 {
-    int argc = 5;
-    int* contents = new int[argc];
-    if (HandleIntStream(is, argc, contents))
-    {
-        int id = contents[0];
-        ASSERT(m_crossesIndexMap.find(id) == m_crossesIndexMap.end());
-        m_crossesIndexMap[id] = m_crosses.size();
-        m_crosses.push_back(new Cross(id, m_crosses.size(), contents[1], contents[2], contents[3], contents[4]));
-    }
-    delete[] contents;
+    ASSERT_MSG(argc == 5, "argc=" << argc);
+    int id = argv[0];
+    m_crossesIndexer.Input(id, m_crosses.size());
+    m_crosses.push_back(new Cross(id, m_crosses.size(), argv[1], argv[2], argv[3], argv[4]));
     return true;
 }
 
-bool Scenario::HandleRoad(std::istream& is)
+bool Scenario::HandleRoad(const int* argv, const int& argc)
 {
-    int argc = 7;
-    int* contents = new int[argc];
-    if (HandleIntStream(is, argc, contents))
-    {
-        int id = contents[0];
-        ASSERT(m_roadsIndexMap.find(id) == m_roadsIndexMap.end());
-        m_roadsIndexMap[id] = m_roads.size();
-        ASSERT(contents[6] == 1 || contents[6] == 0);
-        m_roads.push_back(new Road(id, m_roads.size(), contents[1], contents[2], contents[3], contents[4], contents[5], contents[6] == 1));
-    }
-    delete[] contents;
+    ASSERT_MSG(argc == 7, "argc=" << argc);
+    int id = argv[0];
+    m_roadsIndexer.Input(id, m_roads.size());
+    ASSERT(argv[6] == 1 || argv[6] == 0);
+    m_roads.push_back(new Road(id, m_roads.size(), argv[1], argv[2], argv[3], argv[4], argv[5], argv[6] == 1));
     return true;
 }
 
-bool Scenario::HandleAnswer(std::istream& is)
+bool Scenario::HandleAnswer(const int* argv, const int& argc)
 {
-    char c;
-    is >> c;
-    if (c == '#')
-        return true;
-    if (c != '(')
-        ASSERT(false);
-    int argv[2];
-    for (int i = 0; i < 2; ++i)
-    {
-        argv[i] = -1;
-        is >> argv[i] >> c;
-        ASSERT_MSG(c == ',', "char=" << c << " position=" << i);
-    }
+    ASSERT_MSG(argc >= 3, "argc=" << argc); //id, real time and at least one road
     ASSERT(argv[0] >= 0 && argv[1] >= 0);
     int id = MapCarOriginToIndex(argv[0]);
     Tactics::Instance.GetRealTimes()[id] = argv[1];
-    int path;
-    while (true)
+    Trace& trace = Tactics::Instance.GetTraces()[id];
+    for (int i = 2; i < argc; ++i)
     {
-        path = -1;
-        is >> path >> c;
-        ASSERT(c == ',' || c == ')');
-        ASSERT(path >= 0);
-        auto find = m_roadsIndexMap.find(path);
-        ASSERT(find != m_roadsIndexMap.end());
-        int pathId = find->second;
-        Tactics::Instance.GetTraces()[id].AddToTail(pathId);
-        if (c == ')')
-            break;
+        ASSERT(argv[i] >= 0);
+        trace.AddToTail(MapRoadOriginToIndex(argv[i]));
     }
     return true;
 }
@@ -134,22 +78,41 @@ void Scenario::DoInitialize()
     ClearVector(m_roads);
     m_garageSize.clear();
     m_garageInnerIndex.clear();
-    m_carsIndexMap.clear();
-    m_crossesIndexMap.clear();
-    m_roadsIndexMap.clear();
+    m_carsIndexer.Clear();
+    m_crossesIndexer.Clear();
+    m_roadsIndexer.Clear();
     m_vipCarsN = 0;
     m_presetCarsN = 0;
-    FileReader reader;
-    bool result;
-    LOG("read information of cars from " << Config::PathCar);
-    result = reader.Read(Config::PathCar.c_str(), Callback::Create(&Scenario::HandleCar, this));
-    ASSERT(result);
-    LOG("read information of crosses from " << Config::PathCross);
-    result = reader.Read(Config::PathCross.c_str(), Callback::Create(&Scenario::HandleCross, this));
-    ASSERT(result);
-    LOG("read information of roads from " << Config::PathRoad);
-    result = reader.Read(Config::PathRoad.c_str(), Callback::Create(&Scenario::HandleRoad, this));
-    ASSERT(result);
+    std::vector<std::string> files(ScenarioCache::SECTIONS_N);
+    files[ScenarioCache::CARS] = Config::PathCar;
+    files[ScenarioCache::CROSSES] = Config::PathCross;
+    files[ScenarioCache::ROADS] = Config::PathRoad;
+    files[ScenarioCache::PRESET] = Config::PathPreset;
+    unsigned long long hash = 0;
+    bool result = ScenarioCache::HashFiles(files, hash);
+    ASSERT_MSG(result, "can not read input files");
+    std::string cachePath = Config::PathCache.empty() ? ScenarioCache::GetPathNextTo(Config::PathCar) : Config::PathCache;
+    if (m_cache.Load(cachePath, hash))
+    {
+        LOG("read information of cars, crosses, roads & preset from cache " << cachePath);
+    }
+    else
+    {
+        LOG("read information of cars, crosses, roads & preset from " << Config::PathCar << ", " << Config::PathCross << ", " << Config::PathRoad << ", " << Config::PathPreset);
+        result = m_cache.Build(files, hash);
+        ASSERT(result);
+        if (!m_cache.Save(cachePath))
+            LOG("can not save cache to " << cachePath);
+    }
+    m_cache.ForEach(ScenarioCache::CARS, Callback::Create(&Scenario::HandleCar, this));
+    m_cache.ForEach(ScenarioCache::CROSSES, Callback::Create(&Scenario::HandleCross, this));
+    m_cache.ForEach(ScenarioCache::ROADS, Callback::Create(&Scenario::HandleRoad, this));
+    bool isDistinct = m_carsIndexer.Build();
+    ASSERT_MSG(isDistinct, "duplicated car id");
+    isDistinct = m_crossesIndexer.Build();
+    ASSERT_MSG(isDistinct, "duplicated cross id");
+    isDistinct = m_roadsIndexer.Build();
+    ASSERT_MSG(isDistinct, "duplicated road id");
 
     m_garageSize.resize(m_crosses.size(), 0);
     m_garageInnerIndex.resize(m_cars.size(), -1);
@@ -158,12 +121,9 @@ void Scenario::DoInitialize()
     {
         Car* car = m_cars[i];
         ASSERT((int)i == car->GetId());
-        //check origin input
-        ASSERT(m_crossesIndexMap.find(car->GetFromCrossId()) != m_crossesIndexMap.end());
-        ASSERT(m_crossesIndexMap.find(car->GetToCrossId()) != m_crossesIndexMap.end());
-        //replace information to index
-        car->SetFromCrossId(m_crossesIndexMap[car->GetFromCrossId()]);
-        car->SetToCrossId(m_crossesIndexMap[car->GetToCrossId()]);
+        //replace information to index, unknown origin ids are asserted
+        car->SetFromCrossId(MapCrossOriginToIndex(car->GetFromCrossId()));
+        car->SetToCrossId(MapCrossOriginToIndex(car->GetToCrossId()));
         //set ptr
         car->SetFromCross(m_crosses[car->GetFromCrossId()]);
         car->SetToCross(m_crosses[car->GetToCrossId()]);
@@ -179,26 +139,22 @@ void Scenario::DoInitialize()
         ASSERT((int)i == cross->GetId());
         if (cross->GetNorthRoadId() != -1)
         {
-            ASSERT(m_roadsIndexMap.find(cross->GetNorthRoadId()) != m_roadsIndexMap.end());
-            cross->SetNorthRoadId(m_roadsIndexMap[cross->GetNorthRoadId()]);
+            cross->SetNorthRoadId(MapRoadOriginToIndex(cross->GetNorthRoadId()));
             cross->SetNorthRoad(m_roads[cross->GetNorthRoadId()]);
         }
         if (cross->GetEasthRoadId() != -1)
         {
-            ASSERT(m_roadsIndexMap.find(cross->GetEasthRoadId()) != m_roadsIndexMap.end());
-            cross->SetEasthRoadId(m_roadsIndexMap[cross->GetEasthRoadId()]);
+            cross->SetEasthRoadId(MapRoadOriginToIndex(cross->GetEasthRoadId()));
             cross->SetEasthRoad(m_roads[cross->GetEasthRoadId()]);
         }
         if (cross->GetSouthRoadId() != -1)
         {
-            ASSERT(m_roadsIndexMap.find(cross->GetSouthRoadId()) != m_roadsIndexMap.end());
-            cross->SetSouthRoadId(m_roadsIndexMap[cross->GetSouthRoadId()]);
+            cross->SetSouthRoadId(MapRoadOriginToIndex(cross->GetSouthRoadId()));
             cross->SetSouthRoad(m_roads[cross->GetSouthRoadId()]);
         }
         if (cross->GetWestRoadId() != -1)
         {
-            ASSERT(m_roadsIndexMap.find(cross->GetWestRoadId()) != m_roadsIndexMap.end());
-            cross->SetWestRoadId(m_roadsIndexMap[cross->GetWestRoadId()]);
+            cross->SetWestRoadId(MapRoadOriginToIndex(cross->GetWestRoadId()));
             cross->SetWestRoad(m_roads[cross->GetWestRoadId()]);
         }
     }
@@ -206,10 +162,8 @@ void Scenario::DoInitialize()
     {
         Road* road = m_roads[i];
         ASSERT((int)i == road->GetId());
-        ASSERT(m_crossesIndexMap.find(road->GetStartCrossId()) != m_crossesIndexMap.end());
-        ASSERT(m_crossesIndexMap.find(road->GetEndCrossId()) != m_crossesIndexMap.end());
-        road->SetStartCrossId(m_crossesIndexMap[road->GetStartCrossId()]);
-        road->SetEndCrossId(m_crossesIndexMap[road->GetEndCrossId()]);
+        road->SetStartCrossId(MapCrossOriginToIndex(road->GetStartCrossId()));
+        road->SetEndCrossId(MapCrossOriginToIndex(road->GetEndCrossId()));
         road->SetStartCross(m_crosses[road->GetStartCrossId()]);
         road->SetEndCross(m_crosses[road->GetEndCrossId()]);
     }
@@ -217,9 +171,7 @@ void Scenario::DoInitialize()
 
 void Scenario::DoMoreInitialize()
 {
-    LOG("read information of preset from " << Config::PathPreset);
-    bool result = FileReader().Read(Config::PathPreset.c_str(), Callback::Create(&Scenario::HandleAnswer, this));
-    ASSERT(result);
+    m_cache.ForEach(ScenarioCache::PRESET, Callback::Create(&Scenario::HandleAnswer, this));
 }
 
 void Scenario::Initialize()
@@ -245,24 +197,3 @@ const int& Scenario::GetGarageInnerIndex(const int& carId)
     ASSERT((int)Instance.m_garageInnerIndex.size() > carId);
     return Instance.m_garageInnerIndex[carId];
 }
-
-const int& Scenario::MapCarOriginToIndex(const int& origin)
-{
-    auto find = Instance.m_carsIndexMap.find(origin);
-    ASSERT(find != Instance.m_carsIndexMap.end());
-    return find->second;
-}
-
-const int& Scenario::MapCrossOriginToIndex(const int& origin)
-{
-    auto find = Instance.m_crossesIndexMap.find(origin);
-    ASSERT(find != Instance.m_crossesIndexMap.end());
-    return find->second;
-}
-
-const int& Scenario::MapRoadOriginToIndex(const int& origin)
-{
-    auto find = Instance.m_roadsIndexMap.find(origin);
-    ASSERT(find != Instance.m_roadsIndexMap.end());
-    return find->second;
-}
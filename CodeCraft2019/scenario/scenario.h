@@ -9,6 +9,8 @@
 #include <iostream>
 #include "map-array.h"
 #include "memory-pool.h"
+#include "scenario-cache.h"
+#include "dense-indexer.h"
 
 typedef unsigned int uint;
 
@@ -21,20 +23,22 @@ private:
     std::vector<int> m_garageSize;
     std::vector<int> m_garageInnerIndex;
 
-    std::map<int, int> m_carsIndexMap;
-    std::map<int, int> m_crossesIndexMap;
-    std::map<int, int> m_roadsIndexMap;
+    DenseIndexer m_carsIndexer; //origin id -> index
+    DenseIndexer m_crossesIndexer;
+    DenseIndexer m_roadsIndexer;
 
     int m_vipCarsN;
     int m_presetCarsN;
+    ScenarioCache m_cache; //tuples of input files, kept for reading preset again in Reset
     
     Scenario();
     static Scenario Instance;
     
-    bool HandleCar(std::istream& is);
-    bool HandleCross(std::istream& is);
-    bool HandleRoad(std::istream& is);
-    bool HandleAnswer(std::istream& is);
+    /* handlers of one tuple read from input files */
+    bool HandleCar(const int* argv, const int& argc);
+    bool HandleCross(const int* argv, const int& argc);
+    bool HandleRoad(const int* argv, const int& argc);
+    bool HandleAnswer(const int* argv, const int& argc);
     void DoInitialize();
     void DoMoreInitialize();
     
@@ -51,9 +55,9 @@ public:
 
     static const int& GetGarageSize(const int& id);
     static const int& GetGarageInnerIndex(const int& carId);
-    static const int& MapCarOriginToIndex(const int& origin);
-    static const int& MapCrossOriginToIndex(const int& origin);
-    static const int& MapRoadOriginToIndex(const int& origin);
+    inline static int MapCarOriginToIndex(const int& origin);
+    inline static int MapCrossOriginToIndex(const int& origin);
+    inline static int MapRoadOriginToIndex(const int& origin);
     
 };//class Scenario
 
@@ -91,4 +95,25 @@ inline const int& Scenario::GetPresetCarsN()
     return Instance.m_presetCarsN;
 }
 
+inline int Scenario::MapCarOriginToIndex(const int& origin)
+{
+    int index = Instance.m_carsIndexer.Output(origin);
+    ASSERT_MSG(index != DenseIndexer::NoneIndex, "car " << origin);
+    return index;
+}
+
+inline int Scenario::MapCrossOriginToIndex(const int& origin)
+{
+    int index = Instance.m_crossesIndexer.Output(origin);
+    ASSERT_MSG(index != DenseIndexer::NoneIndex, "cross " << origin);
+    return index;
+}
+
+inline int Scenario::MapRoadOriginToIndex(const int& origin)
+{
+    int index = Instance.m_roadsIndexer.Output(origin);
+    ASSERT_MSG(index != DenseIndexer::NoneIndex, "road " << origin);
+    return index;
+}
+
 #endif
@@ -10,15 +10,7 @@ void GarageCounter::Initialize(SimScenario& scenario)
     int totalCarsN = scenario.GetCarInGarageN();
     for (uint i = 0; i < scenario.Garages().size(); ++i)
     {
-        m_leftCarsN[i] = 0;
-        for (uint j = 0; j < scenario.Garages()[i].size(); ++j)
-        {
-            SimCar* car = scenario.Garages()[i][j];
-            if (car != 0 && car->GetIsInGarage())
-            {
-                ++m_leftCarsN[i];
-            }
-        }
+        m_leftCarsN[i] = scenario.GetGarageIndex().GetCarsN(i);
         m_dispatchCarsNInEachTime[i] = m_leftCarsN[i] * scenario.Garages().size() * 1.0 / totalCarsN;
         m_carsN[i] = m_leftCarsN[i];
     }
@@ -26,14 +18,12 @@ void GarageCounter::Initialize(SimScenario& scenario)
     m_bestCars.resize(scenario.Garages().size());
 }
 
-int StaticTime = 0;
-
 bool CompareCar(SimCar* a, SimCar* b)
 {
     if (a->GetCar()->GetIsVip() != b->GetCar()->GetIsVip())
         return a->GetCar()->GetIsVip();
-    if (a->CalculateSpendTime(StaticTime) != b->CalculateSpendTime(StaticTime))
-        return (a->CalculateSpendTime(StaticTime) > b->CalculateSpendTime(StaticTime));
+    if (a->CalculateSpendTime() != b->CalculateSpendTime())
+        return (a->CalculateSpendTime() > b->CalculateSpendTime());
     if (a->GetCar()->GetMaxSpeed() != b->GetCar()->GetMaxSpeed())
         return a->GetCar()->GetMaxSpeed() < b->GetCar()->GetMaxSpeed();
     return a->GetCar()->GetOriginId() < b->GetCar()->GetOriginId();
@@ -42,20 +32,17 @@ bool CompareCar(SimCar* a, SimCar* b)
 void GarageCounter::Update(const int& time, SimScenario& scenario)
 {
     m_isScheduling = true;
-    StaticTime = time;
+    GarageIndex& garageIndex = scenario.GetGarageIndex();
+    garageIndex.Advance(time);
     for (uint i = 0; i < scenario.Garages().size(); ++i)
     {
-        m_leftCarsN[i] = 0;
+        m_leftCarsN[i] = garageIndex.GetCarsN(i);
         m_bestCars[i].clear();
-        for (uint j = 0; j < scenario.Garages()[i].size(); ++j)
+        for (int vip = 0; vip < 2; ++vip)
         {
-            SimCar* car = scenario.Garages()[i][j];
-            if (car != 0 && car->GetIsInGarage())
-            {
-                ++m_leftCarsN[i];
-                if (car->GetRealTime() <= time)
-                    m_bestCars[i].push_back(car);
-            }
+            const GarageIndex::ReadyList& cars = garageIndex.GetReadyCars(i, vip != 0);
+            for (uint iCar = 0; iCar < cars.size(); ++iCar)
+                m_bestCars[i].push_back(cars[iCar].Car);
         }
         m_bestCars[i].sort(&CompareCar);
     }
@@ -76,7 +63,6 @@ void GarageCounter::HandleBeforeGarageDispatch(const int& time, SimScenario& sce
                 SimCar* car = scenario.Garages()[i][j];
                 if (car != 0 && car->GetIsInGarage() && car->GetRealTime() <= time && Simulator::Instance.CanCarGetOutFromGarage(time, scenario, car).first > 0)
                 {
-                    auto value = car->CalculateSpendTime(time);
                     if (m_bestCars[i].size() == 0)
                         m_bestCars[i].push_back(car);
                     else
@@ -117,10 +103,10 @@ bool GarageCounter::CanDispatch(const int& time, SimScenario& scenario, SimCar*
     if (m_isScheduling)
     {
         ASSERT(car->GetCar()->GetIsVip());
-        //return car->GetCar()->GetMaxSpeed() == m_smallestSpeed[garageId] && car->CalculateSpendTime(time) >= m_longestSpendTime[garageId] * 0.75;
+        //return car->GetCar()->GetMaxSpeed() == m_smallestSpeed[garageId] && car->CalculateSpendTime() >= m_longestSpendTime[garageId] * 0.75;
         return car->GetCar()->GetIsVip() == front->GetCar()->GetIsVip()
             && car->GetCar()->GetMaxSpeed() <= front->GetCar()->GetMaxSpeed() *1.25
-            && car->CalculateSpendTime(time) >= front->CalculateSpendTime(time) * 0.75;
+            && car->CalculateSpendTime() >= front->CalculateSpendTime() * 0.75;
     }
 
     int index = 0;
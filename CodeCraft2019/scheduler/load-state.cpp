@@ -21,18 +21,8 @@ void LoadState::Update(const int& time, SimScenario& scenario)
     for (uint i = 0; i < scenario.Roads().size(); ++i)
     {
         SimRoad* road = scenario.Roads()[i];
-        int lanes = road->GetRoad()->GetLanes();
-        int load = 0;
-        int loadOpposite = 0;
-        for (int i = 0; i < lanes * 2; ++i)
-        {
-            bool opposite = i >= lanes;
-            if (opposite && !road->GetRoad()->GetIsTwoWay())
-                break;
-            (opposite ? loadOpposite : load) += road->GetCars((i % lanes) + 1, opposite).size();
-        }
-        m_spaceLoad[std::make_pair(road->GetRoad()->GetId(), false)] += load;
-        m_spaceLoad[std::make_pair(road->GetRoad()->GetId(), true)] += loadOpposite;
+        m_spaceLoad[std::make_pair(road->GetRoad()->GetId(), false)] += road->GetCarN(false);
+        m_spaceLoad[std::make_pair(road->GetRoad()->GetId(), true)] += road->GetCarN(true);
     }
 }
 
@@ -0,0 +1,92 @@
+#include "recompute-gate.h"
+#include "assert.h"
+#include "log.h"
+#include <cmath>
+
+RecomputeGate::RecomputeGate()
+    : m_deltaThreshold(-1), m_maxInterval(0)
+    , m_capacity(0), m_baseTime(-1)
+    , m_recomputeN(0), m_skipN(0), m_recomputeCost(0), m_isRecomputing(false)
+{ }
+
+void RecomputeGate::SetDeltaThreshold(double v)
+{
+    m_deltaThreshold = v;
+}
+
+void RecomputeGate::SetMaxInterval(int v)
+{
+    m_maxInterval = v;
+}
+
+void RecomputeGate::Initialize(SimScenario& scenario)
+{
+    m_baseOccupancy.clear();
+    m_baseOccupancy.resize(scenario.Roads().size() * 2, 0);
+    m_capacity = 0;
+    for (uint i = 0; i < scenario.Roads().size(); ++i)
+    {
+        Road* road = scenario.Roads()[i]->GetRoad();
+        int capacity = road->GetLanes() * road->GetLength();
+        m_capacity += road->GetIsTwoWay() ? capacity * 2 : capacity;
+    }
+    m_baseTime = -1;
+}
+
+int RecomputeGate::GetDelta(SimScenario& scenario, bool saveAsBase)
+{
+    ASSERT(m_baseOccupancy.size() == scenario.Roads().size() * 2);
+    int delta = 0;
+    for (uint i = 0; i < scenario.Roads().size(); ++i)
+    {
+        SimRoad* road = scenario.Roads()[i];
+        for (int opposite = 0; opposite < 2; ++opposite)
+        {
+            if (opposite && !road->GetRoad()->GetIsTwoWay())
+                break;
+            int load = road->GetCarN(opposite != 0);
+            int& base = m_baseOccupancy[i * 2 + opposite];
+            delta += std::abs(load - base);
+            if (saveAsBase)
+                base = load;
+        }
+    }
+    return delta;
+}
+
+bool RecomputeGate::NeedRecompute(const int& time, SimScenario& scenario)
+{
+    bool need = m_deltaThreshold < 0 //disabled
+        || m_baseTime < 0 || time <= m_baseTime //first time or dropped back by dead lock solver
+        || (m_maxInterval > 0 && time - m_baseTime >= m_maxInterval)
+        || GetDelta(scenario, false) > m_deltaThreshold * m_capacity;
+    if (!need)
+    {
+        ++m_skipN;
+        return false;
+    }
+    if (m_deltaThreshold >= 0)
+        GetDelta(scenario, true);
+    m_baseTime = time;
+    ++m_recomputeN;
+    m_isRecomputing = true;
+    m_recomputeStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+void RecomputeGate::NotifyRecomputeEnd()
+{
+    if (!m_isRecomputing)
+        return;
+    m_isRecomputing = false;
+    m_recomputeCost += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_recomputeStart).count();
+}
+
+void RecomputeGate::Print() const
+{
+    double average = m_recomputeN > 0 ? m_recomputeCost / m_recomputeN : 0;
+    LOG("recompute " << m_recomputeN
+        << " skip " << m_skipN
+        << " cost " << m_recomputeCost << "s"
+        << " saved about " << (average * m_skipN) << "s");
+}
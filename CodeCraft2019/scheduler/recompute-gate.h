@@ -0,0 +1,42 @@
+#ifndef RECOMPUTE_GATE_H
+#define RECOMPUTE_GATE_H
+
+#include "sim-scenario.h"
+#include <vector>
+#include <chrono>
+
+/* skip the expensive recomputing of traces while the load of roads hardly changes */
+class RecomputeGate
+{
+public:
+    RecomputeGate(); //disabled until a threshold is set
+
+    void SetDeltaThreshold(double v); //L1 delta of occupancy / total capacity, [<0] means recompute every time
+    void SetMaxInterval(int v); //recompute at least once in [v] ticks, [<=0] means no limit
+
+    void Initialize(SimScenario& scenario);
+    bool NeedRecompute(const int& time, SimScenario& scenario); //[true] : take a snapshot of occupancy as new base
+    void NotifyRecomputeEnd(); //close the cost record of last recompute
+    void Print() const;
+
+private:
+    double m_deltaThreshold;
+    int m_maxInterval;
+
+    /* road index * 2 + opposite -> cars on road */
+    std::vector<int> m_baseOccupancy;
+    int m_capacity;
+    int m_baseTime;
+
+    /* statistic */
+    int m_recomputeN;
+    int m_skipN;
+    double m_recomputeCost; //wall clock seconds, cpu time of the pool threads would be summed
+    bool m_isRecomputing;
+    std::chrono::steady_clock::time_point m_recomputeStart;
+
+    int GetDelta(SimScenario& scenario, bool saveAsBase);
+
+};//class RecomputeGate
+
+#endif
@@ -2,6 +2,7 @@
 #include "scenario.h"
 #include "assert.h"
 #include "log.h"
+#include "profiler.h"
 #include <algorithm>
 #include "tactics.h"
 #include "simulator.h"
@@ -14,6 +15,8 @@ SchedulerFloyd::SchedulerFloyd()
     : m_updateInterval(2)
     , m_lastVipCarRealTime(0)
     , m_carsNumOnRoadLimit(-1)
+    , m_updateTime(-1)
+    , m_updateScenario(0)
 { 
     SetLengthWeight(0.1);
     SetCarNumWeight(0.9);
@@ -110,6 +113,21 @@ void SchedulerFloyd::SetLooserCarsNumOnRoadLimit(int v)
     m_looserCarsNumOnRoadLimit = v;
 }
 
+void SchedulerFloyd::SetThreadsN(int v)
+{
+    m_threadPool.SetThreadsN(v);
+}
+
+void SchedulerFloyd::SetRecomputeDeltaThreshold(double v)
+{
+    m_recomputeGate.SetDeltaThreshold(v);
+}
+
+void SchedulerFloyd::SetRecomputeMaxInterval(int v)
+{
+    m_recomputeGate.SetMaxInterval(v);
+}
+
 bool IsProtected(const SimCar* car)
 {
     return car->GetCar()->GetIsVip();
@@ -117,8 +135,8 @@ bool IsProtected(const SimCar* car)
 
 bool CompareVipCarsFloyd(SimCar* a, SimCar* b)
 {
-    int ta = a->CalculateSpendTime(true);
-    int tb = b->CalculateSpendTime(true);
+    int ta = a->CalculateSpendTime();
+    int tb = b->CalculateSpendTime();
     return ta != tb ? ta > tb : a->GetCar()->GetOriginId() < b->GetCar()->GetOriginId();
 }
 
@@ -171,20 +189,22 @@ void SchedulerFloyd::CalculateWeight(SimScenario& scenario)
                 if (car->GetCar()->GetIsPreset())
                 {
                     vipCarNumInPreset++;
-                    int arriveTime = realTime + car->CalculateSpendTime(true);
+                    int arriveTime = realTime + car->CalculateSpendTime();
                     if (m_lastPresetVipCarEstimateArriveTime < 0 || arriveTime > m_lastPresetVipCarEstimateArriveTime)
                         m_lastPresetVipCarEstimateArriveTime = arriveTime;
-                    vipPresetArriveSpendTime += car->CalculateSpendTime(true);
+                    vipPresetArriveSpendTime += car->CalculateSpendTime();
                 }
                 vipStartTime += car->GetRealTime();
             }
         }
     }
-    if (Scenario::GetVipCarsN() > 0)
+    m_vipCarTraceProtectedStartTime = 0;
+    if (Scenario::GetVipCarsN() > 0 && vipCarNumInPreset > 0) //generated maps may have no preset car
     {
         vipStartTime /= Scenario::GetVipCarsN();
         vipPresetArriveSpendTime /= vipCarNumInPreset;
-        int vipProtectedTimeSpan = Scenario::GetVipCarsN() * vipPresetArriveSpendTime / 25 / (m_lastVipCarRealTime - vipStartTime);
+        int vipStartSpan = m_lastVipCarRealTime - vipStartTime;
+        int vipProtectedTimeSpan = vipStartSpan > 0 ? Scenario::GetVipCarsN() * vipPresetArriveSpendTime / 25 / vipStartSpan : 0;
         vipProtectedTimeSpan = std::min(100, std::max(40, vipProtectedTimeSpan));
         m_vipCarTraceProtectedStartTime = std::max(0, m_lastVipCarRealTime - vipProtectedTimeSpan);
     }
@@ -236,6 +256,7 @@ void SchedulerFloyd::DoInitialize(SimScenario& scenario)
     int roadCount = Scenario::Roads().size();
 
     CalculateWeight(scenario);
+    m_recomputeGate.Initialize(scenario);
 
     if (m_isFasterAtEndStep)
     {
@@ -302,12 +323,7 @@ void SchedulerFloyd::DoHandleBecomeFirstPriority(const int& time, SimScenario& s
     {
         int nextRoadId = car->GetNextRoadId();
         SimRoad* roadLink = scenario.Roads()[nextRoadId];
-        int roadLines = roadLink->GetRoad()->GetLanes();
-        double carAver = 0;
-        for (int j = 1; j <= roadLines; j++)
-        {
-            carAver += (double)roadLink->GetCarsFrom(j, car->GetCurrentCross()->GetId()).size();
-        }
+        double carAver = (double)roadLink->GetCarNFrom(car->GetCurrentCross()->GetId());
         carAver = carAver / (double)roadLink->GetRoad()->GetLanes();
         if (carAver >= (double)roadLink->GetRoad()->GetLength() - 3.0)
         {
@@ -319,12 +335,7 @@ void SchedulerFloyd::DoHandleBecomeFirstPriority(const int& time, SimScenario& s
                 if (road != 0 && road != car->GetCurrentRoad() && road != roadLink->GetRoad() && road->CanStartFrom(cross->GetId()))
                 {
                     SimRoad* roadLinkNew = scenario.Roads()[road->GetId()];
-                    int roadLines = roadLinkNew->GetRoad()->GetLanes();
-                    double carAverCal = 0;
-                    for (int j = 1; j <= roadLines; j++)
-                    {
-                        carAverCal += (double)roadLinkNew->GetCarsFrom(j, car->GetCurrentCross()->GetId()).size();
-                    }
+                    double carAverCal = (double)roadLinkNew->GetCarNFrom(car->GetCurrentCross()->GetId());
                     carAverCal = carAverCal / (double)roadLinkNew->GetRoad()->GetLanes();
                     if (carAverCal < (double)roadLinkNew->GetRoad()->GetLength() - 3.0)
                     {
@@ -350,6 +361,8 @@ void SchedulerFloyd::DoUpdate(int& time, SimScenario& scenario)
     }
 
     uint crossSize = Scenario::Crosses().size();
+    GarageIndex& garageIndex = scenario.GetGarageIndex();
+    garageIndex.Advance(time);
     for (uint iCross = 0; iCross < crossSize; ++iCross)
     {
         //int carNum = 0;
@@ -357,24 +370,25 @@ void SchedulerFloyd::DoUpdate(int& time, SimScenario& scenario)
             m_garagePlanCarNum[iCross] = m_garagePlanCarNum[iCross] == 0 ? 1 : m_garagePlanCarNum[iCross] + 1;
         int minSpeedInGarage = -1;
         int minVipSpeedInGarage = -1;
-        auto& garage = scenario.Garages()[iCross];
-        for (uint iCar = 0; iCar < garage.size(); ++iCar)
+        for (int vip = 0; vip < 2; ++vip) //minimum does not depend on order of cars
         {
-            if (garage[iCar] != 0 && garage[iCar]->GetIsInGarage() && !garage[iCar]->GetCar()->GetIsPreset())
+            const GarageIndex::ReadyList& ready = garageIndex.GetReadyCars(iCross, vip != 0);
+            for (uint iCar = 0; iCar < ready.size(); ++iCar)
             {
-                //carNum++;
-                if (garage[iCar]->GetRealTime() > time)
+                SimCar* car = ready[iCar].Car;
+                if (car->GetCar()->GetIsPreset())
                     continue;
-                if (minSpeedInGarage > garage[iCar]->GetCar()->GetMaxSpeed() || minSpeedInGarage < 0)
+                //carNum++;
+                if (minSpeedInGarage > car->GetCar()->GetMaxSpeed() || minSpeedInGarage < 0)
                 {
-                    minSpeedInGarage = garage[iCar]->GetCar()->GetMaxSpeed();
+                    minSpeedInGarage = car->GetCar()->GetMaxSpeed();
                     m_garageMinSpeed[iCross].first = minSpeedInGarage;
                 }
-                if (garage[iCar]->GetCar()->GetIsVip())
+                if (car->GetCar()->GetIsVip())
                 {
-                    if (minVipSpeedInGarage > garage[iCar]->GetCar()->GetMaxSpeed() || minVipSpeedInGarage < 0)
+                    if (minVipSpeedInGarage > car->GetCar()->GetMaxSpeed() || minVipSpeedInGarage < 0)
                     {
-                        minVipSpeedInGarage = garage[iCar]->GetCar()->GetMaxSpeed();
+                        minVipSpeedInGarage = car->GetCar()->GetMaxSpeed();
                         m_garageMinSpeed[iCross].second = minVipSpeedInGarage;
                     }
                 }
@@ -386,7 +400,15 @@ void SchedulerFloyd::DoUpdate(int& time, SimScenario& scenario)
             m_connectionCrossToCross[iCross][jCross] = jCross;
         }
     }
-    if (time % m_updateInterval != 0)
+    bool isCancelled = IsCancelled();
+    if (isCancelled && time > m_deadLockSolver.GetDeadLockTime())
+    {
+        //out of time, finish the run with the traces we have, only replan after dropped back by dead lock solver
+        UpdateGarageTraceSizeLimit(scenario);
+        m_garageDispatchCounter.Update(time, scenario);
+        return;
+    }
+    if (time % m_updateInterval != 0 || !m_recomputeGate.NeedRecompute(time, scenario))
     {
         m_garageDispatchCounter.Update(time, scenario);
         return;
@@ -460,11 +482,8 @@ void SchedulerFloyd::DoUpdate(int& time, SimScenario& scenario)
                     {
                         carAver += m_weightCrossToCross[iCross][peerlink->GetId()];
                     }
-                    int roadLines = roadLink->GetRoad()->GetLanes();                   
-                    for (int j = 1; j <= roadLines; j++)
-                    {
-                        carAver += (double)roadLink->GetCarsFrom(j, iCross).size();
-                    }
+                    int roadLines = roadLink->GetRoad()->GetLanes();
+                    carAver += (double)roadLink->GetCarNFrom(iCross);
                     carAver = carAver/ (double)roadLink->GetRoad()->GetLanes();
                     //wsq
                     
@@ -485,8 +504,81 @@ void SchedulerFloyd::DoUpdate(int& time, SimScenario& scenario)
         }
     }
 
+    PROFILE_SCOPE(relaxScope, "floyd.relax");
+    if (!RelaxWeights(!isCancelled))
+    {
+        //weights are half done, keep the traces we have
+        m_recomputeGate.NotifyRecomputeEnd();
+        UpdateGarageTraceSizeLimit(scenario);
+        m_garageDispatchCounter.Update(time, scenario);
+        return;
+    }
+    relaxScope.Stop();
+    
+    //rebuild paths & rewrite traces, each row/car only touches its own slot
+    PROFILE_SCOPE(pathsScope, "floyd.paths");
+    m_updateTime = time;
+    m_updateScenario = &scenario;
+    m_threadPool.ParallelFor(0, crossSize, Callback::Create(&SchedulerFloyd::UpdateMinPathFrom, this));
+    if (m_isDropBackByDijkstra) //dijkstra is using static buffers
+    {
+        for (uint i = 0; i < scenario.Cars().size(); ++i)
+            UpdateCarTraceByMinPath(i);
+    }
+    else
+    {
+        m_threadPool.ParallelFor(0, scenario.Cars().size(), Callback::Create(&SchedulerFloyd::UpdateCarTraceByMinPath, this));
+    }
+    m_updateScenario = 0;
+    pathsScope.Stop();
+    m_recomputeGate.NotifyRecomputeEnd();
+    UpdateGarageTraceSizeLimit(scenario);
+    m_garageDispatchCounter.Update(time, scenario);
+}
+
+void SchedulerFloyd::UpdateGarageTraceSizeLimit(SimScenario& scenario)
+{
+    uint crossSize = Scenario::Crosses().size();
+    GarageIndex& garageIndex = scenario.GetGarageIndex();
+    for (uint iCross = 0; iCross < crossSize; ++iCross)
+    {
+        int maxCarTraceSizeInGarage = -1;
+        int maxVipCarTraceSizeInGarage = -1;
+        //cars can go in garage, in garage order : the vip branch keeps the last slow vip car instead of a max, so order matters
+        std::vector<SimCar*>& garage = m_garageReadyCars;
+        garageIndex.GetReadyCars(iCross, garage);
+        for (uint iCar = 0; iCar < garage.size(); ++iCar)
+        {
+            if (!garage[iCar]->GetCar()->GetIsPreset())
+            {
+                if (garage[iCar]->GetCar()->GetMaxSpeed() <= m_garageMinSpeed[iCross].first)
+                {
+                    if (maxCarTraceSizeInGarage < garage[iCar]->GetTrace().Size() || maxCarTraceSizeInGarage < 0)
+                    {
+                        maxCarTraceSizeInGarage = garage[iCar]->GetTrace().Size();
+                        m_garageTraceSizeLimit[iCross].first = maxCarTraceSizeInGarage;
+                    }
+                }
+                if (garage[iCar]->GetCar()->GetIsVip() && garage[iCar]->GetCar()->GetMaxSpeed() <= m_garageMinSpeed[iCross].second)
+                {
+                    if (maxVipCarTraceSizeInGarage < garage[iCar]->GetTrace().Size() || maxVipCarTraceSizeInGarage < 0)
+                    {
+                        maxCarTraceSizeInGarage = garage[iCar]->GetTrace().Size();
+                        m_garageTraceSizeLimit[iCross].second = maxCarTraceSizeInGarage;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool SchedulerFloyd::RelaxWeights(const bool& canCancel)
+{
+    uint crossSize = Scenario::Crosses().size();
     for (uint iTransfer = 0; iTransfer < crossSize; ++iTransfer)
     {
+        if (canCancel && IsCancelled())
+            return false;
         for (uint iRow = 0; iRow < crossSize; ++iRow)
         {
             for (uint iColumn = 0; iColumn < crossSize; ++iColumn)
@@ -509,148 +601,122 @@ void SchedulerFloyd::DoUpdate(int& time, SimScenario& scenario)
             ASSERT(m_weightCrossToCross[iRow][iColumn] != Inf);
         }
     }
-    
-    for (uint iStart = 0; iStart < crossSize; ++iStart)
+    return true;
+}
+
+void SchedulerFloyd::UpdateMinPathFrom(int iStart)
+{
+    uint crossSize = Scenario::Crosses().size();
+    std::vector<int> crossList;
+    crossList.reserve(crossSize);
+    for (int iEnd = 0; iEnd < (int)crossSize; ++iEnd)
     {
-        for (uint iEnd = 0; iEnd < crossSize; ++iEnd)
+        int startStep = iStart;
+        crossList.clear();
+        while (startStep != iEnd)
         {
-            int startStep = iStart;
-            static std::vector<int> crossList;
-            crossList.clear();
-            while (startStep != iEnd)
+            int transstep = m_connectionCrossToCross[startStep][iEnd];
+            while (m_connectionCrossToCross[startStep][transstep] != transstep)
             {
-                int transstep = m_connectionCrossToCross[startStep][iEnd];
-                while (m_connectionCrossToCross[startStep][transstep] != transstep)
-                {
-                    transstep = m_connectionCrossToCross[startStep][transstep];
-                }
-                startStep = transstep;
-                ASSERT(m_weightCrossToCross[startStep][iEnd] != Inf);
-                crossList.push_back(startStep);
+                transstep = m_connectionCrossToCross[startStep][transstep];
             }
+            startStep = transstep;
+            ASSERT(m_weightCrossToCross[startStep][iEnd] != Inf);
+            crossList.push_back(startStep);
+        }
 
-            //trans crosses to roads
-            auto& pathList = m_minPathCrossToCross[iStart][iEnd];
-            pathList.clear();
-            Cross* lastCross = Scenario::Crosses()[iStart];
-            for (uint i = 0; i < crossList.size(); ++i)
+        //trans crosses to roads
+        auto& pathList = m_minPathCrossToCross[iStart][iEnd];
+        pathList.clear();
+        Cross* lastCross = Scenario::Crosses()[iStart];
+        for (uint i = 0; i < crossList.size(); ++i)
+        {
+            bool consistant = false;
+            Cross* thisCross = Scenario::Crosses()[crossList[i]];
+            for (int i = (int)Cross::NORTH; i <= (int)Cross::WEST; i++)
             {
-                bool consistant = false;
-                Cross* thisCross = Scenario::Crosses()[crossList[i]];
-                for (int i = (int)Cross::NORTH; i <= (int)Cross::WEST; i++)
+                Road* road = lastCross->GetRoad((Cross::DirectionType)i);
+                if (road != 0)
                 {
-                    Road* road = lastCross->GetRoad((Cross::DirectionType)i);
-                    if (road != 0)
+                    if (road->CanStartFrom(lastCross->GetId()) && road->CanReachTo(thisCross->GetId()))
                     {
-                        if (road->CanStartFrom(lastCross->GetId()) && road->CanReachTo(thisCross->GetId()))
-                        {
-                            consistant = true;
-                            pathList.push_back(road->GetId());
-                            break;
-                        }
+                        consistant = true;
+                        pathList.push_back(road->GetId());
+                        break;
                     }
                 }
-                ASSERT_MSG(consistant, "can not find the road bewteen " << lastCross->GetId() << " and " << thisCross->GetId());
-                lastCross = thisCross;
             }
+            ASSERT_MSG(consistant, "can not find the road bewteen " << lastCross->GetId() << " and " << thisCross->GetId());
+            lastCross = thisCross;
         }
     }
+}
 
-    for(uint i = 0; i < scenario.Cars().size(); ++i)
+void SchedulerFloyd::UpdateCarTraceByMinPath(int i)
+{
+    SimScenario& scenario = *m_updateScenario;
+    const int& time = m_updateTime;
+    SimCar* car = scenario.Cars()[i];
+    if (car == 0) return;
+    auto& carTrace = car->GetTrace();
+    if (car->GetCar()->GetFromCrossId() != car->GetCar()->GetToCrossId()
+        && !car->GetIsReachedGoal()
+        && (!car->GetCar()->GetIsPreset() || car->GetCanChangePath())
+        && !m_deadLockSolver.IsCarTraceLockedInBackup(car))
     {
-        SimCar* car = scenario.Cars()[i];
-        if (car == 0) continue;
-        auto& carTrace = car->GetTrace();
-        if (car->GetCar()->GetFromCrossId() != car->GetCar()->GetToCrossId()
-            && !car->GetIsReachedGoal()
-            && (!car->GetCar()->GetIsPreset() || car->GetCanChangePath())
-            && !m_deadLockSolver.IsCarTraceLockedInBackup(car))
-        {
-            int from = car->GetCar()->GetFromCrossId();
-            if (!car->GetIsInGarage() && car->GetCurrentRoad() != 0)
-                from = car->GetCurrentCross()->GetId();
-            int to = car->GetCar()->GetToCrossId();
-            const auto* newTrace = &m_minPathCrossToCross[from][to];
+        int from = car->GetCar()->GetFromCrossId();
+        if (!car->GetIsInGarage() && car->GetCurrentRoad() != 0)
+            from = car->GetCurrentCross()->GetId();
+        int to = car->GetCar()->GetToCrossId();
+        const auto* newTrace = &m_minPathCrossToCross[from][to];
 
-            if (!car->GetIsLockOnNextRoad())
+        if (!car->GetIsLockOnNextRoad())
+        {
+            if (car->GetIsInGarage())
+                carTrace.Clear();
+            else
             {
-                if (car->GetIsInGarage())
-                    carTrace.Clear();
-                else
+                if (!(carTrace.Size() > 0 && newTrace->size() > 0 && *newTrace->begin() == car->GetCurrentRoad()->GetId()))
                 {
-                    if (!(carTrace.Size() > 0 && newTrace->size() > 0 && *newTrace->begin() == car->GetCurrentRoad()->GetId()))
-                    {
-                        carTrace.Clear(car->GetCurrentTraceIndex());
-                    }
-                    //drop back
-                    if (m_isDropBackByDijkstra && (carTrace.Size() > 0 && newTrace->size() > 0 && *newTrace->begin() == car->GetCurrentRoad()->GetId()))
-                    {
-                        UpdateCarTraceByDijkstra(time, scenario, car);
-                    }
+                    carTrace.Clear(car->GetCurrentTraceIndex());
                 }
-            }
-
-            if (!car->GetIsLockOnNextRoad()  //will be updated
-                && carTrace.Size() != 0 && newTrace != 0 && newTrace->size() > 0 //on the road
-                && newTrace == &m_minPathCrossToCross[from][to]) //and no drop back
-                ASSERT(*(carTrace.Tail() - 1) != *newTrace->begin()); //check next jump
-            if (!car->GetIsLockOnNextRoad() && (!(carTrace.Size() > 0 && newTrace->size() > 0 && *newTrace->begin() == car->GetCurrentRoad()->GetId()))) //can not update road if locked
-            {
-                for (auto traceIte = newTrace->begin(); traceIte != newTrace->end(); traceIte++)
+                //drop back
+                if (m_isDropBackByDijkstra && (carTrace.Size() > 0 && newTrace->size() > 0 && *newTrace->begin() == car->GetCurrentRoad()->GetId()))
                 {
-                    //ASSERT(carTrace.Size() == 0 || (*(carTrace.Tail() - 1) != *traceIte));
-                    carTrace.AddToTail(*traceIte);
+                    UpdateCarTraceByDijkstra(time, scenario, car);
                 }
             }
         }
-#ifdef ASSERT_ON
-        //check path valid
-        ASSERT(carTrace.Size() > 0);
-        Cross* frontCross = car->GetCar()->GetFromCross();
-        int frontRoad = -1;
-        for (auto ite = carTrace.Head(); ite != carTrace.Tail(); ite++)
-        {
-            Road* road = Scenario::Roads()[*ite];
-            ASSERT(road != 0);
-            ASSERT(road->GetId() >= 0);
-            ASSERT(road->GetId() != frontRoad);
-            ASSERT(road->CanStartFrom(frontCross->GetId()));
-            frontCross = road->GetPeerCross(frontCross);
-        }
-        //ASSERT(frontCross->GetId() == car->GetCar()->GetToCrossId());
-#endif
-    }
-    for (uint iCross = 0; iCross < crossSize; ++iCross)
-    {
-        int maxCarTraceSizeInGarage = -1;
-        int maxVipCarTraceSizeInGarage = -1;
-        auto& garage = scenario.Garages()[iCross];
-        for (uint iCar = 0; iCar < garage.size(); ++iCar)
+
+        if (!car->GetIsLockOnNextRoad()  //will be updated
+            && carTrace.Size() != 0 && newTrace != 0 && newTrace->size() > 0 //on the road
+            && newTrace == &m_minPathCrossToCross[from][to]) //and no drop back
+            ASSERT(*(carTrace.Tail() - 1) != *newTrace->begin()); //check next jump
+        if (!car->GetIsLockOnNextRoad() && (!(carTrace.Size() > 0 && newTrace->size() > 0 && *newTrace->begin() == car->GetCurrentRoad()->GetId()))) //can not update road if locked
         {
-            if (garage[iCar] != 0 && garage[iCar]->GetIsInGarage() && !garage[iCar]->GetCar()->GetIsPreset())
+            for (auto traceIte = newTrace->begin(); traceIte != newTrace->end(); traceIte++)
             {
-                if (garage[iCar]->GetRealTime() > time )
-                    continue;
-                if (garage[iCar]->GetCar()->GetMaxSpeed() <= m_garageMinSpeed[iCross].first)
-                {
-                    if (maxCarTraceSizeInGarage < garage[iCar]->GetTrace().Size() || maxCarTraceSizeInGarage < 0)
-                    {
-                        maxCarTraceSizeInGarage = garage[iCar]->GetTrace().Size();
-                        m_garageTraceSizeLimit[iCross].first = maxCarTraceSizeInGarage;
-                    }
-                }
-                if (garage[iCar]->GetCar()->GetIsVip() && garage[iCar]->GetCar()->GetMaxSpeed() <= m_garageMinSpeed[iCross].second)
-                {
-                    if (maxVipCarTraceSizeInGarage < garage[iCar]->GetTrace().Size() || maxVipCarTraceSizeInGarage < 0)
-                    {
-                        maxCarTraceSizeInGarage = garage[iCar]->GetTrace().Size();
-                        m_garageTraceSizeLimit[iCross].second = maxCarTraceSizeInGarage;
-                    }
-                }
+                //ASSERT(carTrace.Size() == 0 || (*(carTrace.Tail() - 1) != *traceIte));
+                carTrace.AddToTail(*traceIte);
             }
         }
     }
-    m_garageDispatchCounter.Update(time, scenario);
+#ifdef ASSERT_ON
+    //check path valid
+    ASSERT(carTrace.Size() > 0);
+    Cross* frontCross = car->GetCar()->GetFromCross();
+    int frontRoad = -1;
+    for (auto ite = carTrace.Head(); ite != carTrace.Tail(); ite++)
+    {
+        Road* road = Scenario::Roads()[*ite];
+        ASSERT(road != 0);
+        ASSERT(road->GetId() >= 0);
+        ASSERT(road->GetId() != frontRoad);
+        ASSERT(road->CanStartFrom(frontCross->GetId()));
+        frontCross = road->GetPeerCross(frontCross);
+    }
+    //ASSERT(frontCross->GetId() == car->GetCar()->GetToCrossId());
+#endif
 }
 
 void SchedulerFloyd::DoHandleBeforeGarageDispatch(const int& time, SimScenario& scenario)
@@ -724,11 +790,7 @@ void SchedulerFloyd::DoHandleGetoutGarage(const int& time, SimScenario& scenario
     ASSERT(roadId >= 0);
     SimRoad* road = scenario.Roads()[roadId];
     int crossId = car->GetCar()->GetFromCrossId();
-    int carSum = 0;
-    for (int i = 1; i <= road->GetRoad()->GetLanes(); i++)
-    {
-        carSum += road->GetCarsFrom(i, crossId).size();
-    }
+    int carSum = road->GetCarNFrom(crossId);
     double carAver = double(carSum) / double(road->GetRoad()->GetLanes());
     
     if (!m_isVipCarDispatchFree)
@@ -768,6 +830,7 @@ void SchedulerFloyd::DoHandleResult(int& time, SimScenario& scenario, Simulator:
 {
     if (result.Conflict)
     {
+        PROFILE_ZONE("deadlock.handle");
         if (m_deadLockSolver.HandleDeadLock(time, scenario))
         {
             result.Conflict = false; //retry
@@ -778,8 +841,11 @@ void SchedulerFloyd::DoHandleResult(int& time, SimScenario& scenario, Simulator:
     {
         if (time > 0 && time % 100 == 0)
         {
+            PROFILE_ZONE("deadlock.backup");
             m_deadLockSolver.Backup(time, scenario);
         }
+        if (scenario.IsComplete())
+            m_recomputeGate.Print();
     }
 }
 
@@ -806,6 +872,7 @@ bool SchedulerFloyd::UpdateCarTraceByDijkstra(const int& time, const SimScenario
 
 bool SchedulerFloyd::UpdateCarTraceByDijkstra(const int& time, const SimScenario& scenario, const std::vector<int>& validFirstHop, SimCar* car) const
 {
+    PROFILE_ZONE("floyd.dijkstra");
     //ASSERT(!car->GetIsInGarage());
     ASSERT(!car->GetIsReachedGoal());
     ASSERT(validFirstHop.size() > 0);
@@ -856,11 +923,7 @@ bool SchedulerFloyd::UpdateCarTraceByDijkstra(const int& time, const SimScenario
                 ASSERT(road->GetStartCrossId() == from ||
                     (road->GetEndCrossId() == from && road->GetIsTwoWay()));
                 Cross* nearCross = road->GetPeerCross(cross);
-                int carAverager = 0;
-                for (int j = 1; j <= roadLink->GetRoad()->GetLanes(); j++)
-                {
-                    carAverager += roadLink->GetCarsFrom(j, from).size();
-                }
+                int carAverager = roadLink->GetCarNFrom(from);
                 carAverager = carAverager / roadLink->GetRoad()->GetLanes();
                 int roadLength = road->GetLength();
                 lengthMap[from][nearCross->GetId()] = ((double)roadLength) * m_lengthWeight + (double)carAverager * (double)carAverager * (double)carAverager / (double)roadLength;//m_carNumWeight;
@@ -879,12 +942,8 @@ bool SchedulerFloyd::UpdateCarTraceByDijkstra(const int& time, const SimScenario
                         (roadLink->GetRoad()->GetEndCrossId() == cross->GetId() && roadLink->GetRoad()->GetIsTwoWay()))
                     {
                         Cross* peerlink = roadLink->GetRoad()->GetPeerCross(cross);
-                        int carAver = 0;
+                        int carAver = roadLink->GetCarNFrom(cross->GetId());
                         int roadLanes = roadLink->GetRoad()->GetLanes();
-                        for (int j = 1; j <= roadLink->GetRoad()->GetLanes(); j++)
-                        {
-                            carAver += roadLink->GetCarsFrom(j, cross->GetId()).size();
-                        }
                         carAver = carAver / roadLink->GetRoad()->GetLanes();
                         int roadLength = cross->GetRoad((Cross::DirectionType)i)->GetLength();
                         lengthMap[cross->GetId()][peerlink->GetId()] = ((double)roadLength) * m_lengthWeight + (double)carAver * (double)carAver * (double)carAver / (double)roadLength;//m_carNumWeight;
@@ -1087,11 +1146,7 @@ bool SchedulerFloyd::UpdateCarTraceByDijkstraWithTimeWeight(const int& time, con
                 ASSERT(road->GetStartCrossId() == from ||
                     (road->GetEndCrossId() == from && road->GetIsTwoWay()));
                 Cross* nearCross = road->GetPeerCross(cross);
-                int carAverager = 0;
-                for (int j = 1; j <= roadLink->GetRoad()->GetLanes(); j++)
-                {
-                    carAverager += roadLink->GetCarsFrom(j, from).size();
-                }
+                int carAverager = roadLink->GetCarNFrom(from);
                 carAverager = carAverager / roadLink->GetRoad()->GetLanes();
                 int roadLength = road->GetLength();
                 lengthMap[from][nearCross->GetId()] = ((double)roadLength) * m_lengthWeight + (double)carAverager * (double)carAverager * (double)carAverager / (double)roadLength;//m_carNumWeight;
@@ -1110,12 +1165,8 @@ bool SchedulerFloyd::UpdateCarTraceByDijkstraWithTimeWeight(const int& time, con
                         (roadLink->GetRoad()->GetEndCrossId() == cross->GetId() && roadLink->GetRoad()->GetIsTwoWay()))
                     {
                         Cross* peerlink = roadLink->GetRoad()->GetPeerCross(cross);
-                        int carAver = 0;
+                        int carAver = roadLink->GetCarNFrom(cross->GetId());
                         int roadLanes = roadLink->GetRoad()->GetLanes();
-                        for (int j = 1; j <= roadLink->GetRoad()->GetLanes(); j++)
-                        {
-                            carAver += roadLink->GetCarsFrom(j, cross->GetId()).size();
-                        }
                         carAver = carAver / roadLink->GetRoad()->GetLanes();
                         int roadLength = cross->GetRoad((Cross::DirectionType)i)->GetLength();
                         lengthMap[cross->GetId()][peerlink->GetId()] = ((double)roadLength) * m_lengthWeight / 2.0 + (double)carAver * (double)carAver * (double)carAver / (double)roadLength;//m_carNumWeight;
@@ -5,6 +5,8 @@
 #include <list>
 #include "dead-lock-solver.h"
 #include "garage-counter.h"
+#include "thread-pool.h"
+#include "recompute-gate.h"
 
 class SchedulerFloyd : public Scheduler
 {
@@ -27,6 +29,9 @@ public:
     void SetVipCarOptimalStartTime(int v);
     void HandleSimCarScheduled(const SimCar* car);
     void SetLooserCarsNumOnRoadLimit(int v);
+    void SetThreadsN(int v); //[0] means number of hardware threads
+    void SetRecomputeDeltaThreshold(double v); //[<0] (default) means recompute at every update interval
+    void SetRecomputeMaxInterval(int v); //recompute at least once in [v] ticks while a threshold is set, [<=0] (default) means no limit
 protected:
     virtual void DoInitialize(SimScenario& scenario) override;
     virtual void DoUpdate(int& time, SimScenario& scenario) override;
@@ -54,6 +59,7 @@ private:
     std::vector< std::pair<int, int> > m_garageMinSpeed;
     std::vector< std::pair<int, int> > m_garageTraceSizeLimit;
     std::vector<int> m_garagePlanCarNum;
+    std::vector<SimCar*> m_garageReadyCars; //buffer of UpdateGarageTraceSizeLimit
     GarageCounter m_garageDispatchCounter;
 
     /* for solving dead lock */
@@ -68,8 +74,15 @@ private:
     bool UpdateCarTraceByDijkstra(const int& time, const SimScenario& scenario, SimCar* car) const;
     bool UpdateCarTraceByDijkstra(const int& time, const SimScenario& scenario, const std::vector<int>& validFirstHop, SimCar* car) const;
 
+    /* parallel tasks of updating, index -> own slot only */
+    ThreadPool m_threadPool;
+    void UpdateMinPathFrom(int iStart);
+    void UpdateCarTraceByMinPath(int i);
+    void UpdateGarageTraceSizeLimit(SimScenario& scenario); //trace size limits of cars can go in garage, by their traces now
+    bool RelaxWeights(const bool& canCancel); //floyd pass over m_weightCrossToCross, [false] if cancelled in the middle
 
     int m_updateInterval;
+    RecomputeGate m_recomputeGate;
 
     /* weight */
     double m_lengthWeight;
@@ -99,6 +112,10 @@ private:
     /* temporary variables */
     double m_roadCapacityAverage;
     int m_carsNumOnRoadLimit;
+    int m_updateTime;
+    SimScenario* m_updateScenario;
+
+    friend class MicroBench; //runs the kernels alone
 
 };//class SchedulerFloyd
 
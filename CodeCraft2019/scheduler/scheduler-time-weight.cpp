@@ -7,7 +7,8 @@
 #include <math.h>
 
 //std::vector< std::vector< std::vector<double> > > SchedulerTimeWeight::m_confidence;
-std::vector< std::vector< std::vector<double> > > SchedulerTimeWeight::m_collectionWeight;
+std::vector<SchedulerTimeWeight::WeightBand> SchedulerTimeWeight::m_collectionBand;
+std::vector<double> SchedulerTimeWeight::m_collectionWeight;
 int SchedulerTimeWeight::m_maxValidRange;
 
 double firstThreshold = 0.2;
@@ -32,6 +33,14 @@ inline double AdaptToLeftCarsN(const double& min, const double& max)
     return max - pow(leftCarsN * 1.0 / Scenario::Cars().size(), 2) * (max - min);
 }
 
+SchedulerTimeWeight::WeightBand::WeightBand()
+    : Start(0), Length(0), Offset(0)
+{ }
+
+SchedulerTimeWeight::CarWeightFootprint::CarWeightFootprint()
+    : BaseTime(-1), TraceIndex(0), IsInGarage(false), StartTime(-1), CoveredTime(-1)
+{ }
+
 void SchedulerTimeWeight::InitilizeConfidence()
 {
     static bool initialized = false;
@@ -46,21 +55,18 @@ void SchedulerTimeWeight::InitilizeConfidence()
     double bound = 0.5e-5; //10w cars -> 0.5 weight
 
     std::vector< std::vector<double> > binomial;
-    std::vector< std::vector< std::vector<double> > > confidence;
+    std::vector< std::vector<double> > confidence; //confidence(deltaT, a, b) of current a : [deltaT][b]
+    std::vector<double> collection(maxN, 0); //w'(a, b, deltaT) of current a & b : [deltaT]
     binomial.resize(maxN);
     confidence.resize(maxN);
-    m_collectionWeight.resize(maxN);
     for (int i = 0; i < maxN; ++i)
     {
         binomial[i].resize(maxN, 1);
-        confidence[i].resize(maxN);
-        m_collectionWeight[i].resize(maxN);
-        for (int j = 0; j < maxN; ++j)
-        {
-            confidence[i][j].resize(maxN, 0);
-            m_collectionWeight[i][j].resize(maxN, 0);
-        }
+        confidence[i].resize(maxN, 0);
     }
+    m_collectionBand.clear();
+    m_collectionBand.resize(maxN * maxN);
+    m_collectionWeight.clear();
 
     binomial[0][0] = 1.0;
     for (int i = 1; i < maxN; ++i)
@@ -71,45 +77,56 @@ void SchedulerTimeWeight::InitilizeConfidence()
         for (int j = 1; j < maxN; ++j)
             binomial[i][j] = (1.0 - p) * binomial[i - 1][j] + p * binomial[i - 1][j - 1];
 
-    for (int t = 0; t < maxN; ++t)
+    //simplify confidence[deltaT][a][b] to collection weight[a][b][past]
+    //walk a downward, so confidence(t, a, b) = binomial(t, a) + confidence(t, a + 1, b) only needs one layer
+    for (int a = maxN - 1; a >= 0; --a)
     {
-        for (int b = 0; b < maxN; ++b)
+        for (int t = 0; t < maxN; ++t)
         {
-            confidence[t][b][b] = binomial[t][b];
-            for (int a = b - 1; a >= 0; --a)
-                confidence[t][a][b] = binomial[t][a] + confidence[t][a + 1][b];
+            confidence[t][a] = binomial[t][a];
+            for (int b = a + 1; b < maxN; ++b)
+                confidence[t][b] = binomial[t][a] + confidence[t][b];
         }
-    }
-
-    //simplify confidence[deltaT][a][b] to collection weight[a][b][past]
-    for (int a = 0; a < maxN; ++a)
-    {
         for (int b = a; b < maxN; ++b)
         {
             int tmpb = a;
             int tmpt = a;
             bool decreasing = false;
-            double lastW = confidence[tmpt][a][tmpb];
+            double lastW = confidence[tmpt][tmpb];
+            int first = maxN;
+            int last = -1;
             while (tmpt < maxN)
             {
-                double thisW = confidence[tmpt][a][tmpb];
+                double thisW = confidence[tmpt][tmpb];
                 if (lastW > thisW) decreasing = true;
                 if (decreasing && thisW < bound) break;
 
                 //transform to w'
                 for (int past = 0; past <= tmpt; ++past)
+                {
                     if (binomial[tmpt][tmpt - past] < bound) break;
-                    else m_collectionWeight[a][b][tmpt - past] += binomial[tmpt][tmpt - past] * thisW;
+                    collection[tmpt - past] += binomial[tmpt][tmpt - past] * thisW;
+                    first = std::min(first, tmpt - past);
+                    last = std::max(last, tmpt - past);
+                }
 
                 ++tmpt;
                 if (tmpb < b) ++tmpb;
             }
+            //keep the band only
+            WeightBand& band = m_collectionBand[a * maxN + b];
+            band.Offset = m_collectionWeight.size();
+            band.Start = first;
+            band.Length = std::max(0, last - first + 1);
+            for (int t = first; t <= last; ++t)
+            {
+                m_collectionWeight.push_back(collection[t]);
+                collection[t] = 0;
+            }
         }
     }
 }
 
-int CompareToken = 0;
-
 struct CompareCarForDispatchStruct
 {
     bool operator () (SimCar* a, SimCar* b)
@@ -122,8 +139,8 @@ struct CompareCarForDispatchStruct
             return ac->GetMaxSpeed() < bc->GetMaxSpeed();
         if (a->GetRealTime() != b->GetRealTime())
             return a->GetRealTime() < b->GetRealTime();
-        if (a->CalculateSpendTime(CompareToken) != b->CalculateSpendTime(CompareToken))
-            return a->CalculateSpendTime(CompareToken) > b->CalculateSpendTime(CompareToken);
+        if (a->CalculateSpendTime() != b->CalculateSpendTime())
+            return a->CalculateSpendTime() > b->CalculateSpendTime();
         return ac->GetId() < bc->GetId();
     }
 
@@ -131,7 +148,24 @@ struct CompareCarForDispatchStruct
 
 SchedulerTimeWeight::SchedulerTimeWeight()
     : m_updateInterval(1), m_carWeightStartTime(-1)
-{ }
+{
+    SetIsTimeAwareInitialTrace(false);
+}
+
+void SchedulerTimeWeight::SetRecomputeDeltaThreshold(double v)
+{
+    m_recomputeGate.SetDeltaThreshold(v);
+}
+
+void SchedulerTimeWeight::SetRecomputeMaxInterval(int v)
+{
+    m_recomputeGate.SetMaxInterval(v);
+}
+
+void SchedulerTimeWeight::SetIsTimeAwareInitialTrace(bool v)
+{
+    m_isTimeAwareInitialTrace = v;
+}
 
 void SchedulerTimeWeight::InitializeBestTraceByFloyd()
 {
@@ -191,12 +225,15 @@ void SchedulerTimeWeight::InitializeBestTraceByFloyd()
         }
     }
 
+    m_bestTrace.resize(crossSize * crossSize);
+    m_bestTraceRoads.clear();
+    std::vector<int> crossList;
+    crossList.reserve(crossSize);
     for (uint iStart = 0; iStart < crossSize; ++iStart)
     {
         for (uint iEnd = 0; iEnd < crossSize; ++iEnd)
         {
             int startStep = iStart;
-            static std::vector<int> crossList;
             crossList.clear();
             while (startStep != iEnd)
             {
@@ -211,9 +248,10 @@ void SchedulerTimeWeight::InitializeBestTraceByFloyd()
             }
 
             //trans crosses to roads
-            auto& pathList = m_bestTrace[iStart][iEnd];
-            pathList.second = flodyWeight[iStart][iEnd];
-            pathList.first.clear();
+            BestTrace& best = m_bestTrace[iStart * crossSize + iEnd];
+            best.Offset = m_bestTraceRoads.size();
+            best.Size = crossList.size();
+            best.Length = flodyWeight[iStart][iEnd];
             Cross* lastCross = Scenario::Crosses()[iStart];
             for (uint i = 0; i < crossList.size(); ++i)
             {
@@ -227,7 +265,7 @@ void SchedulerTimeWeight::InitializeBestTraceByFloyd()
                         if (road->CanStartFrom(lastCross->GetId()) && road->CanReachTo(thisCross->GetId()))
                         {
                             consistant = true;
-                            pathList.first.push_back(road->GetId());
+                            m_bestTraceRoads.push_back(road->GetId());
                             break;
                         }
                     }
@@ -245,31 +283,27 @@ void SchedulerTimeWeight::InitializeCarTraceByBeastTrace(SimScenario& scenario)
     {
         SimCar* car = scenario.Cars()[i];
         if (car->GetCar()->GetIsPreset()) continue;
-        auto& best = m_bestTrace[car->GetCar()->GetFromCrossId()][car->GetCar()->GetToCrossId()].first;
-        for (auto ite = best.begin(); ite != best.end(); ite++)
-            car->GetTrace().AddToTail(*ite);
+        const BestTrace& best = m_bestTrace[car->GetCar()->GetFromCrossId() * Scenario::Crosses().size() + car->GetCar()->GetToCrossId()];
+        for (int iRoad = 0; iRoad < best.Size; ++iRoad)
+            car->GetTrace().AddToTail(m_bestTraceRoads[best.Offset + iRoad]);
     }
 }
 
 void SchedulerTimeWeight::InitializeCarTraceByDijkstra(SimScenario& scenario)
 {
     uint crossCount = Scenario::Crosses().size();
-    std::vector< std::vector<double> > dijkWeight;
-    std::vector<int> dijkLengthList;
-    std::vector<bool> dijkVisitedList;
-    std::vector<int> dijkPathLastCrossId;
-    dijkWeight.resize(crossCount);
-    dijkLengthList.resize(crossCount);
-    dijkVisitedList.resize(crossCount);
-    dijkPathLastCrossId.resize(crossCount);
+    m_loadWeight.resize(crossCount);
     for (uint i = 0; i < crossCount; ++i)
-        dijkWeight[i].resize(crossCount, Inf);
+    {
+        m_loadWeight[i].clear();
+        m_loadWeight[i].resize(crossCount, Inf);
+    }
     for (uint i = 0; i < Scenario::Roads().size(); ++i)
     {
         const Road* road = Scenario::Roads()[i];
-        dijkWeight[road->GetStartCrossId()][road->GetEndCrossId()] = road->GetLength();
+        m_loadWeight[road->GetStartCrossId()][road->GetEndCrossId()] = road->GetLength();
         if (road->GetIsTwoWay())
-            dijkWeight[road->GetEndCrossId()][road->GetStartCrossId()] = road->GetLength();
+            m_loadWeight[road->GetEndCrossId()][road->GetStartCrossId()] = road->GetLength();
     }
 
     std::vector< std::vector<SimCar*> > cars;
@@ -286,7 +320,7 @@ void SchedulerTimeWeight::InitializeCarTraceByDijkstra(SimScenario& scenario)
             {
                 const Road* road = Scenario::Roads()[car->GetTrace()[i]];
                 Cross* peer = road->GetPeerCross(cross);
-                dijkWeight[cross->GetId()][peer->GetId()] += 1.0; //car->GetCar()->GetIsPreset() ? 2.0 : 1.0;
+                m_loadWeight[cross->GetId()][peer->GetId()] += 1.0; //car->GetCar()->GetIsPreset() ? 2.0 : 1.0;
                 cross = peer;
             }
         }
@@ -305,96 +339,33 @@ void SchedulerTimeWeight::InitializeCarTraceByDijkstra(SimScenario& scenario)
             --notEndCount;
     std::vector<int> indexInGarage;
     indexInGarage.resize(Scenario::Crosses().size(), 0);
+    std::vector<int> noBaned;
     while (notEndCount > 0)
     for (uint i = 0; i < Scenario::Crosses().size(); ++i)
     {
+        if (IsCancelled())
+            return; //cars left keep their last traces
         if (cars[i].size() == indexInGarage[i]) continue;
         SimCar* car = cars[i][indexInGarage[i]];
 
-        int from = car->GetCar()->GetFromCross()->GetId();
-        int to = car->GetCar()->GetToCross()->GetId();
-        //calculate
-        for (uint iCross = 0; iCross < crossCount; ++iCross)
+        if (m_isTimeAwareInitialTrace && m_carWeightStartTime >= 0)
         {
-            if (from != iCross)
-            {
-                dijkLengthList[iCross] = dijkWeight[from][iCross];
-                dijkPathLastCrossId[iCross] = from;
-            }
-            else
-            {
-                dijkLengthList[iCross] = Inf;
-                dijkPathLastCrossId[iCross] = -1;
-            }
-            dijkVisitedList[iCross] = false;
-        }
-        dijkLengthList[from] = 0;
-        dijkPathLastCrossId[from] = from;
-        dijkVisitedList[from] = true;
-        for (uint iExtend = 0; iExtend < crossCount - 1; ++iExtend)
-        {
-            int min = Inf;
-            int visited = -1;
-            for (uint iMin = 0; iMin < crossCount; ++iMin)
-            {
-                if (!dijkVisitedList[iMin] && dijkLengthList[iMin] < min)
-                {
-                    min = dijkLengthList[iMin];
-                    visited = iMin;
-                }
-            }
-
-            ASSERT(visited != -1);
-            dijkVisitedList[visited] = true;
-            for (uint iUpdate = 0; iUpdate < crossCount; ++iUpdate)
-            {
-                if (!dijkVisitedList[iUpdate])
-                {
-                    double thisLenght = min + dijkWeight[visited][iUpdate];
-                    if (thisLenght< dijkLengthList[iUpdate])
-                    {
-                        dijkLengthList[iUpdate] = thisLenght;
-                        dijkPathLastCrossId[iUpdate] = visited;
-                    }
-                }
-            }
+            int firstHopTime = std::max(m_carWeightStartTime, car->GetRealTime()) - m_carWeightStartTime;
+            bool ret = m_dijkstra.Search(car, firstHopTime, noBaned, m_timeWeightCallback);
+            ASSERT_MSG(ret, "can not find the trace of car " << car->GetCar()->GetOriginId());
         }
-
-        std::vector<int> crossListDiji;
-
-        int endCrossId = to;
-        while (endCrossId != from)
+        else
         {
-            crossListDiji.push_back(endCrossId);
-            endCrossId = dijkPathLastCrossId[endCrossId];
+            bool ret = m_dijkstra.Search(car, 0, noBaned, m_loadWeightCallback);
+            ASSERT_MSG(ret, "can not find the trace of car " << car->GetCar()->GetOriginId());
         }
-        //crossListDiji.push_front(endCrossId);
-
-        //check path valid
-        car->GetTrace().Clear();
+        //more cars, more weight
         Cross* lastCross = car->GetCar()->GetFromCross();
-        if (!car->GetIsInGarage())
-            lastCross = car->GetCurrentCross();
-        for (int crossIndex = crossListDiji.size() - 1; crossIndex >= 0; --crossIndex)
+        for (uint iTrace = 0; iTrace < car->GetTrace().Size(); ++iTrace)
         {
-            bool consistant = false;
-            Cross* thisCross = Scenario::Crosses()[crossListDiji[crossIndex]];
-            for (int dirIndex = (int)Cross::NORTH; dirIndex <= (int)Cross::WEST; dirIndex++)
-            {
-                Road* road = lastCross->GetRoad((Cross::DirectionType)dirIndex);
-                if (road != 0)
-                {
-                    if ((road->GetStartCrossId() == lastCross->GetId() && road->GetEndCrossId() == thisCross->GetId())
-                        || (road->GetEndCrossId() == lastCross->GetId() && road->GetStartCrossId() == thisCross->GetId() && road->GetIsTwoWay()))
-                    {
-                        consistant = true;
-                        car->GetTrace().AddToTail(road->GetId());
-                        dijkWeight[lastCross->GetId()][thisCross->GetId()] += 1.5 / sqrt(road->GetLanes());
-                        break;
-                    }
-                }
-            }
-            ASSERT_MSG(consistant, "can not find the road bewteen " << lastCross->GetId() << " and " << thisCross->GetId());
+            Road* road = Scenario::Roads()[car->GetTrace()[iTrace]];
+            Cross* thisCross = road->GetPeerCross(lastCross);
+            m_loadWeight[lastCross->GetId()][thisCross->GetId()] += 1.5 / sqrt(road->GetLanes());
             lastCross = thisCross;
         }
 
@@ -402,6 +373,40 @@ void SchedulerTimeWeight::InitializeCarTraceByDijkstra(SimScenario& scenario)
     }
 }
 
+double SchedulerTimeWeight::GetRoadWeightByTime(int time, Road* road, Cross* from)
+{
+    const double* fifoWeight = GetFifoWeight(road, road->IsFromOrTo(from->GetId()));
+    if (time < m_maxValidRange)
+        return fifoWeight[time];
+    //no car weight after the window
+    return std::max((double)road->GetLength(), fifoWeight[m_maxValidRange - 1] - (time - m_maxValidRange + 1));
+}
+
+const double* SchedulerTimeWeight::GetFifoWeight(Road* road, const bool& dir)
+{
+    int roadDir = road->GetId() * 2 + (dir ? 0 : 1);
+    double* fifoWeight = &m_fifoWeight[roadDir * m_maxValidRange];
+    if (!m_isFifoWeightValid[roadDir])
+    {
+        //the weight falls when cars leave, but reaching later must never get out earlier (FIFO) :
+        //clamp the arrival (index + weight) to the latest arrival before it
+        double arrival = 0;
+        for (int index = 0; index < m_maxValidRange; ++index)
+        {
+            double weight = road->GetLength() + WbaToLengthWeight(GetCarWeight(index, road->GetId(), dir), m_roadCapacity[road->GetId()]);
+            arrival = index == 0 ? weight : std::max(arrival, index + weight);
+            fifoWeight[index] = arrival - index;
+        }
+        m_isFifoWeightValid[roadDir] = true;
+    }
+    return fifoWeight;
+}
+
+double SchedulerTimeWeight::GetRoadWeightByLoad(int time, Road* road, Cross* from)
+{
+    return m_loadWeight[from->GetId()][road->GetPeerCross(from)->GetId()];
+}
+
 void SchedulerTimeWeight::DoInitialize(SimScenario& scenario)
 {
     InitilizeConfidence();
@@ -409,6 +414,10 @@ void SchedulerTimeWeight::DoInitialize(SimScenario& scenario)
 
     m_deadLockSolver.Initialize(0, scenario);
     m_deadLockSolver.SetSelectedRoadCallback(Callback::Create(&SchedulerTimeWeight::SelectBestRoad, this));
+    m_recomputeGate.Initialize(scenario);
+    m_dijkstra.Initialize();
+    m_timeWeightCallback = Callback::Create(&SchedulerTimeWeight::GetRoadWeightByTime, this);
+    m_loadWeightCallback = Callback::Create(&SchedulerTimeWeight::GetRoadWeightByLoad, this);
 
     int roadCount = Scenario::Roads().size();
     int crossCount = Scenario::Crosses().size();
@@ -416,7 +425,11 @@ void SchedulerTimeWeight::DoInitialize(SimScenario& scenario)
     m_roadWeight.resize(roadCount);
     m_roadCapacity.resize(roadCount);
     m_expectedWeight.resize(Scenario::Cars().size());
-    m_bestTrace.resize(crossCount);
+    m_carWeightFootprint.resize(Scenario::Cars().size());
+    m_pendingWeight.resize(roadCount * 2);
+    m_fifoWeight.resize(roadCount * 2 * m_maxValidRange);
+    m_isFifoWeightValid.resize(roadCount * 2, false);
+    m_bestTrace.resize(crossCount * crossCount);
     m_carList.resize(crossCount);
     int maxLanes = 0;
     for (uint i = 0; i < roadCount; i++)
@@ -434,9 +447,6 @@ void SchedulerTimeWeight::DoInitialize(SimScenario& scenario)
         m_threshold[i].second = secondThreshold / sqrt(i);
     }
 
-    for (uint i = 0; i < crossCount; ++i)
-        m_bestTrace[i].resize(crossCount);
-
     //InitializeBestTraceByFloyd();
     //InitializeCarTraceByBeastTrace(scenario);
     //InitializeCarTraceByDijkstra(scenario);
@@ -514,10 +524,13 @@ void SchedulerTimeWeight::DoUpdate(int& time, SimScenario& scenario)
 
     static double updateTime = 1;
     //if (time == 0 || --updateTime == 0)
-    if (time % 50 == 0 || scenario.GetCarInGarageN() < maxServiceCarsN * 0.75)
+    if ((time % 50 == 0 || scenario.GetCarInGarageN() < maxServiceCarsN * 0.75)
+        && !IsCancelled() //out of time, finish the run with the traces we have
+        && m_recomputeGate.NeedRecompute(time, scenario))
     {
         InitializeCarTraceByDijkstra(scenario);
         updateTime = (double)(scenario.GetCarInGarageN() + scenario.GetOnRoadCarsN()) / (double)scenario.Cars().size() * 100.0;
+        m_recomputeGate.NotifyRecomputeEnd();
     }
     
 
@@ -529,14 +542,19 @@ void SchedulerTimeWeight::DoUpdate(int& time, SimScenario& scenario)
     if (m_deadLockSolver.IsGarageLockedInBackup(time))
         return;
 
-    for (uint i = 0; i < scenario.Cars().size(); ++i)
+    GarageIndex& garageIndex = scenario.GetGarageIndex();
+    garageIndex.Advance(time);
+    for (uint i = 0; i < m_carList.size(); ++i)
     {
-        SimCar* car = scenario.Cars()[i];
-        if (!car->GetCar()->GetIsPreset() && car->GetIsInGarage() && car->GetRealTime() <= time)
-            m_carList[car->GetCar()->GetFromCrossId()].push_back(car);
+        for (int vip = 0; vip < 2; ++vip)
+        {
+            const GarageIndex::ReadyList& cars = garageIndex.GetReadyCars(i, vip != 0);
+            for (uint iCar = 0; iCar < cars.size(); ++iCar)
+                if (!cars[iCar].Car->GetCar()->GetIsPreset())
+                    m_carList[i].push_back(cars[iCar].Car);
+        }
     }
 
-    CompareToken = time;
     for (uint i = 0; i < m_carList.size(); ++i)
         std::sort(m_carList[i].begin(), m_carList[i].end(), CompareCarForDispatch);
 
@@ -604,6 +622,8 @@ void SchedulerTimeWeight::DoHandleResult(int& time, SimScenario& scenario, Simul
         {
             m_deadLockSolver.Backup(time, scenario);
         }
+        if (scenario.IsComplete())
+            m_recomputeGate.Print();
     }
 }
 
@@ -624,7 +644,7 @@ void SchedulerTimeWeight::DoHandleBecomeFirstPriority(const int& time, SimScenar
     }
 }
 
-bool SchedulerTimeWeight::IsAppropriateToDispatch(const int& time, SimCar* car, SimScenario& scenario) const
+bool SchedulerTimeWeight::IsAppropriateToDispatch(const int& time, SimCar* car, SimScenario& scenario)
 {
     ASSERT(car->GetIsInGarage());
     if (scenario.GetCarInGarageN() + scenario.GetOnRoadCarsN() < maxServiceCarsN * 0.9)
@@ -643,7 +663,7 @@ bool SchedulerTimeWeight::IsAppropriateToDispatch(const int& time, SimCar* car,
         int index = next.first + time - m_carWeightStartTime;
         if (index < m_maxValidRange)
         {
-            double weight = road->IsFromOrTo(cross->GetId()) ? m_carWeight[index][road->GetId()].first : m_carWeight[index][road->GetId()].second;
+            double weight = GetCarWeight(index, road->GetId(), road->IsFromOrTo(cross->GetId()));
             double factor = weight / m_roadCapacity[road->GetId()];
             if (factor > m_roadCapacity[road->GetId()] * AdaptToLeftCarsN(crowedThreshold, 0.9))
                 return false;
@@ -660,58 +680,166 @@ bool SchedulerTimeWeight::IsAppropriateToDispatch(const int& time, SimCar* car,
 
 void SchedulerTimeWeight::UpdateTimeWeight(const int& time, SimScenario& scenario)
 {
-    m_carWeightStartTime = time;
-    for (uint iTime = 0; iTime < m_maxValidRange; ++iTime)
+    if (m_carWeightStartTime < 0 || time < m_carWeightStartTime || time - m_carWeightStartTime >= m_maxValidRange)
     {
-        for (uint iRoad = 0; iRoad < Scenario::Roads().size(); ++iRoad)
+        //first time, dropped back by dead lock solver or jumped over the whole window : rebuild
+        for (int iTime = 0; iTime < m_maxValidRange; ++iTime)
         {
-            m_carWeight[iTime][iRoad].first = 0;
-            m_carWeight[iTime][iRoad].second = 0;
+            for (uint iRoad = 0; iRoad < Scenario::Roads().size(); ++iRoad)
+            {
+                m_carWeight[iTime][iRoad].first = 0;
+                m_carWeight[iTime][iRoad].second = 0;
+            }
+        }
+        for (uint i = 0; i < m_carWeightFootprint.size(); ++i)
+        {
+            m_carWeightFootprint[i].BaseTime = -1;
+            m_carWeightFootprint[i].Segments.clear();
         }
+        for (uint i = 0; i < m_pendingWeight.size(); ++i)
+            m_pendingWeight[i].clear();
     }
+    else
+    {
+        //retire the expired slices only, they are reused for the end of window
+        for (int iTime = m_carWeightStartTime; iTime < time; ++iTime)
+        {
+            auto& slice = m_carWeight[iTime % m_maxValidRange];
+            for (uint iRoad = 0; iRoad < slice.size(); ++iRoad)
+            {
+                slice[iRoad].first = 0;
+                slice[iRoad].second = 0;
+            }
+        }
+    }
+    m_carWeightStartTime = time;
+    m_isFifoWeightValid.assign(m_isFifoWeightValid.size(), false); //indexes moved
     for (uint i = 0; i < scenario.Cars().size(); ++i)
     {
         SimCar* car = scenario.Cars()[i];
-        if (!car->GetIsReachedGoal() && ((car->GetCar()->GetIsPreset() && !car->GetCanChangePath()) || !car->GetIsInGarage()))
-            UpdateTimeWeightForEachCar(time, car);
+        if (IsCarWeightCounted(car))
+        {
+            if (IsCarWeightChanged(time, car))
+                UpdateTimeWeightForEachCar(time, car);
+        }
+        else if (m_carWeightFootprint[car->GetCar()->GetId()].BaseTime >= 0)
+        {
+            UpdateTimeWeightForEachCar(time, car, true);
+        }
     }
+#ifdef _DEBUG
+    CheckCarWeight(scenario);
+#endif
 }
 
 void SchedulerTimeWeight::UpdateTimeWeightByRoadAndTime(const int& time, const int& roadId, const bool& dir, int startTime, int leaveTime, const bool& isDecrease)
 {
     ASSERT(leaveTime >= startTime && startTime >= time);
-    if (startTime - m_carWeightStartTime >= m_maxValidRange)
+    if (startTime - time >= m_maxValidRange)
         return;
 
-    int deltaStart = startTime - time;
-    int deltaEnd = std::min(leaveTime - time, m_maxValidRange - 1);
-    int indexDelta = time - m_carWeightStartTime;
+    PendingWeight pending;
+    pending.DeltaStart = startTime - time;
+    pending.DeltaEnd = std::min(leaveTime - time, m_maxValidRange - 1);
+    pending.BaseTime = time;
+    pending.IsDecrease = isDecrease;
+
+    m_isFifoWeightValid[roadId * 2 + (dir ? 0 : 1)] = false;
+    //an increase & a decrease of the same band cancel each other before being added
+    auto& list = m_pendingWeight[roadId * 2 + (dir ? 0 : 1)];
+    for (uint i = 0; i < list.size(); ++i)
+    {
+        const PendingWeight& other = list[i];
+        if (other.DeltaStart == pending.DeltaStart && other.DeltaEnd == pending.DeltaEnd
+            && other.BaseTime == pending.BaseTime && other.IsDecrease != pending.IsDecrease)
+        {
+            list[i] = list.back();
+            list.pop_back();
+            return;
+        }
+    }
+    list.push_back(pending);
+    if (list.size() >= 64) //keep the waiting list short for roads rarely read
+        FlushTimeWeight(roadId, dir);
+}
+
+void SchedulerTimeWeight::ApplyTimeWeight(const PendingWeight& pending, const int& roadId, const bool& dir, std::vector< std::vector< std::pair<double, double> > >& carWeight) const
+{
+    const int& deltaStart = pending.DeltaStart;
+    const int& deltaEnd = pending.DeltaEnd;
+    const bool& isDecrease = pending.IsDecrease;
+    int indexDelta = pending.BaseTime - m_carWeightStartTime; //negative for an old band, skip the expired slices
 
-    const auto& collectionWeight = m_collectionWeight[deltaStart][deltaEnd];
-    for (int t = deltaStart - 1; t >= 0; --t) //before
+    const WeightBand& band = m_collectionBand[deltaStart * m_maxValidRange + deltaEnd];
+    const double* collectionWeight = m_collectionWeight.data();
+    for (int t = deltaStart - 1; t >= 0 && t + indexDelta >= 0; --t) //before
     {
-        const double& wba = collectionWeight[t];
+        double wba = band.Get(collectionWeight, t);
         if (wba <= 0) break;
-        (dir ? m_carWeight[t + indexDelta][roadId].first : m_carWeight[t + indexDelta][roadId].second) += isDecrease ? -wba : wba;
+        if (t + indexDelta >= m_maxValidRange) continue;
+        auto& weight = carWeight[GetCarWeightSlot(t + indexDelta)][roadId];
+        (dir ? weight.first : weight.second) += isDecrease ? -wba : wba;
     }
-    for (int t = deltaStart; t <= deltaEnd; ++t)
+    int inBandEnd = std::min(deltaEnd, band.Start + band.Length - 1); //adding zero outside the band changes nothing
+    inBandEnd = std::min(inBandEnd, m_maxValidRange - 1 - indexDelta);
+    for (int t = std::max(std::max(deltaStart, band.Start), -indexDelta); t <= inBandEnd; ++t)
     {
-        (dir ? m_carWeight[t + indexDelta][roadId].first : m_carWeight[t + indexDelta][roadId].second) += isDecrease ? -collectionWeight[t] : collectionWeight[t];
+        double wba = band.Get(collectionWeight, t);
+        auto& weight = carWeight[GetCarWeightSlot(t + indexDelta)][roadId];
+        (dir ? weight.first : weight.second) += isDecrease ? -wba : wba;
     }
     for (int t = deltaEnd + 1; t + indexDelta < m_maxValidRange; ++t) //after
     {
-        const double& wba = collectionWeight[t];
+        double wba = band.Get(collectionWeight, t);
         if (wba <= 0) break;
-        (dir ? m_carWeight[t + indexDelta][roadId].first : m_carWeight[t + indexDelta][roadId].second) += isDecrease ? -wba : wba;
+        if (t + indexDelta < 0) continue;
+        auto& weight = carWeight[GetCarWeightSlot(t + indexDelta)][roadId];
+        (dir ? weight.first : weight.second) += isDecrease ? -wba : wba;
     }
 }
 
-void SchedulerTimeWeight::UpdateTimeWeightForEachCar(const int& originTime, SimCar* car, const bool& isDecrease)
+void SchedulerTimeWeight::FlushTimeWeight(const int& roadId, const bool& dir)
 {
-    if (car->GetIsReachedGoal() || car->GetRealTime() - m_carWeightStartTime >= m_maxValidRange)
+    auto& list = m_pendingWeight[roadId * 2 + (dir ? 0 : 1)];
+    for (uint i = 0; i < list.size(); ++i)
+        ApplyTimeWeight(list[i], roadId, dir, m_carWeight);
+    list.clear();
+}
+
+double SchedulerTimeWeight::GetCarWeight(const int& index, const int& roadId, const bool& dir)
+{
+    FlushTimeWeight(roadId, dir);
+    const auto& weight = m_carWeight[GetCarWeightSlot(index)][roadId];
+    return dir ? weight.first : weight.second;
+}
+
+void SchedulerTimeWeight::UpdateTimeWeightForEachCar(const int& time, SimCar* car, const bool& isDecrease)
+{
+    CarWeightFootprint& footprint = m_carWeightFootprint[car->GetCar()->GetId()];
+    if (footprint.BaseTime >= 0) //take back what was added
+    {
+        for (uint i = 0; i < footprint.Segments.size(); ++i)
+        {
+            const CarWeightSegment& segment = footprint.Segments[i];
+            UpdateTimeWeightByRoadAndTime(footprint.BaseTime, segment.Road, segment.Dir, segment.StartTime, segment.LeaveTime, true);
+        }
+        footprint.BaseTime = -1;
+        footprint.Segments.clear();
+    }
+    if (isDecrease)
         return;
 
-    int time = isDecrease ? m_carWeightStartTime : originTime;
+    if (car->GetIsReachedGoal())
+        return;
+    if (car->GetRealTime() - m_carWeightStartTime >= m_maxValidRange) //nothing in the window, look again when it starts in
+    {
+        footprint.BaseTime = time;
+        footprint.TraceIndex = car->GetCurrentTraceIndex();
+        footprint.IsInGarage = car->GetIsInGarage();
+        footprint.StartTime = car->GetRealTime();
+        footprint.CoveredTime = car->GetRealTime() - 1;
+        return;
+    }
 
     auto& carTrace = car->GetTrace();
     
@@ -722,12 +850,17 @@ void SchedulerTimeWeight::UpdateTimeWeightForEachCar(const int& originTime, SimC
     uint iTrace = car->GetCurrentTraceIndex();
     if (!car->GetIsInGarage())
     {
-        eventTime = car->GetSimState(originTime) == SimCar::SCHEDULED ? time + 1 : time;
+        eventTime = car->GetSimState(time) == SimCar::SCHEDULED ? time + 1 : time;
         pos = car->GetCurrentPosition();
         --iTrace;
         cross = car->GetCurrentRoad()->GetPeerCross(cross);
     }
 
+    footprint.BaseTime = time;
+    footprint.TraceIndex = iTrace;
+    footprint.IsInGarage = car->GetIsInGarage();
+    footprint.StartTime = eventTime;
+    footprint.CoveredTime = -1;
     int lastEventTime = eventTime;
     for ( ; iTrace < carTrace.Size(); ++iTrace)
     {
@@ -738,32 +871,119 @@ void SchedulerTimeWeight::UpdateTimeWeightForEachCar(const int& originTime, SimC
         eventTime += next.first;
         pos = next.second;
 
-        UpdateTimeWeightByRoadAndTime(time, road->GetId(), road->IsFromOrTo(cross->GetId()), lastEventTime, eventTime - 1, isDecrease);
+        CarWeightSegment segment;
+        segment.Road = road->GetId();
+        segment.Dir = road->IsFromOrTo(cross->GetId());
+        segment.StartTime = lastEventTime;
+        segment.LeaveTime = eventTime - 1;
+        footprint.Segments.push_back(segment);
+        UpdateTimeWeightByRoadAndTime(time, segment.Road, segment.Dir, segment.StartTime, segment.LeaveTime, false);
         lastEventTime = eventTime;
         cross = road->GetPeerCross(cross);
     }
+    if (footprint.Segments.size() > 0 && footprint.Segments.back().LeaveTime - time >= m_maxValidRange)
+        footprint.CoveredTime = time + m_maxValidRange - 1; //cut at the end of window
+}
+
+bool SchedulerTimeWeight::IsCarWeightCounted(SimCar* car) const
+{
+    return !car->GetIsReachedGoal() && ((car->GetCar()->GetIsPreset() && !car->GetCanChangePath()) || !car->GetIsInGarage());
+}
+
+bool SchedulerTimeWeight::IsCarWeightChanged(const int& time, SimCar* car) const
+{
+    const CarWeightFootprint& footprint = m_carWeightFootprint[car->GetCar()->GetId()];
+    if (footprint.BaseTime < 0)
+        return true;
+    if (footprint.IsInGarage != car->GetIsInGarage())
+        return true;
+    if (footprint.CoveredTime >= 0 && time + m_maxValidRange - 1 > footprint.CoveredTime) //the window passes the end of prediction
+        return true;
+    if (footprint.Segments.size() == 0) //starts after the window
+        return footprint.StartTime != car->GetRealTime();
+    const Trace& carTrace = car->GetTrace();
+    if (carTrace.Size() != footprint.TraceIndex + footprint.Segments.size())
+        return true;
+    for (uint i = 0; i < footprint.Segments.size(); ++i)
+    {
+        if (carTrace[footprint.TraceIndex + i] != footprint.Segments[i].Road)
+            return true;
+    }
+    if (car->GetIsInGarage())
+        return footprint.StartTime != std::max(time, car->GetRealTime());
+    //still on the predicted road in time
+    int index = car->GetCurrentTraceIndex() - 1 - footprint.TraceIndex;
+    if (index < 0 || index >= (int)footprint.Segments.size())
+        return true;
+    return time > footprint.Segments[index].LeaveTime + 1;
+}
+
+void SchedulerTimeWeight::CheckCarWeight(SimScenario& scenario)
+{
+    uint roadCount = Scenario::Roads().size();
+    std::vector< std::vector< std::pair<double, double> > > rebuild(m_maxValidRange);
+    for (int iTime = 0; iTime < m_maxValidRange; ++iTime)
+        rebuild[iTime].resize(roadCount, std::make_pair(0.0, 0.0));
+    for (uint i = 0; i < scenario.Cars().size(); ++i)
+    {
+        SimCar* car = scenario.Cars()[i];
+        const CarWeightFootprint& footprint = m_carWeightFootprint[car->GetCar()->GetId()];
+        if (!IsCarWeightCounted(car))
+        {
+            ASSERT_MSG(footprint.BaseTime < 0, "car " << car->GetCar()->GetOriginId());
+            continue;
+        }
+        ASSERT_MSG(footprint.BaseTime >= 0, "car " << car->GetCar()->GetOriginId());
+        ASSERT_MSG(footprint.CoveredTime < 0 || footprint.CoveredTime >= m_carWeightStartTime + m_maxValidRange - 1, "car " << car->GetCar()->GetOriginId());
+        for (uint iSegment = 0; iSegment < footprint.Segments.size(); ++iSegment)
+        {
+            const CarWeightSegment& segment = footprint.Segments[iSegment];
+            if (segment.StartTime - footprint.BaseTime >= m_maxValidRange) //same cut as UpdateTimeWeightByRoadAndTime
+                continue;
+            PendingWeight pending;
+            pending.DeltaStart = segment.StartTime - footprint.BaseTime;
+            pending.DeltaEnd = std::min(segment.LeaveTime - footprint.BaseTime, m_maxValidRange - 1);
+            pending.BaseTime = footprint.BaseTime;
+            pending.IsDecrease = false;
+            ApplyTimeWeight(pending, segment.Road, segment.Dir, rebuild);
+        }
+    }
+    for (uint iRoad = 0; iRoad < roadCount; ++iRoad)
+    {
+        FlushTimeWeight(iRoad, true);
+        FlushTimeWeight(iRoad, false);
+        for (int iTime = 0; iTime < m_maxValidRange; ++iTime)
+        {
+            const auto& weight = m_carWeight[iTime][iRoad];
+            const auto& expected = rebuild[iTime][iRoad];
+            ASSERT_MSG(fabs(weight.first - expected.first) < 1e-6 * std::max(1.0, fabs(expected.first))
+                && fabs(weight.second - expected.second) < 1e-6 * std::max(1.0, fabs(expected.second)),
+                "road " << Scenario::Roads()[iRoad]->GetOriginId() << " time " << m_carWeightStartTime + (iTime - m_carWeightStartTime % m_maxValidRange + m_maxValidRange) % m_maxValidRange);
+        }
+    }
 }
 
 void SchedulerTimeWeight::UpdateCurrentWeightByScenario(const int& time, SimScenario& scenario)
 {
     LOG("gosh, the predict must be send to hell! @" << time);
     ASSERT(time >= m_carWeightStartTime);
-    int weightTimeIndex = (time - m_carWeightStartTime) % m_maxValidRange;
+    int weightTimeIndex = time % m_maxValidRange;
+    m_isFifoWeightValid.assign(m_isFifoWeightValid.size(), false);
     for(uint iRoad = 0; iRoad < scenario.Roads().size(); ++iRoad)
     {
         const SimRoad* road = scenario.Roads()[iRoad];
+        FlushTimeWeight(road->GetRoad()->GetId(), true);
+        FlushTimeWeight(road->GetRoad()->GetId(), false);
         auto& weightPair = m_carWeight[weightTimeIndex][road->GetRoad()->GetId()];
         for (int dir = 0; (dir == 0) || (dir == 1 && road->GetRoad()->GetIsTwoWay()); ++dir)
         {
             auto& weight = dir == 0 ? weightPair.first : weightPair.second;
-            weight = 0;
-            for (uint iLane = 0; iLane < road->GetRoad()->GetLanes(); ++iLane)
-                weight += road->GetCars(iLane, dir == 1).size();
+            weight = road->GetCarN(dir == 1);
         }
     }
 }
 
-bool SchedulerTimeWeight::UpdateCarTraceByDijkstraWithTimeWeight(const int& time, SimScenario& scenario, SimCar* car, const std::vector<int>& banedFirstHop) const
+bool SchedulerTimeWeight::UpdateCarTraceByDijkstraWithTimeWeight(const int& time, SimScenario& scenario, SimCar* car, const std::vector<int>& banedFirstHop)
 {
     ASSERT(!car->GetIsReachedGoal());
     ASSERT(banedFirstHop.size() < 4);
@@ -776,216 +996,8 @@ bool SchedulerTimeWeight::UpdateCarTraceByDijkstraWithTimeWeight(const int& time
     ASSERT(firstHopTime >= m_carWeightStartTime);
     firstHopTime -= m_carWeightStartTime;
 
-    struct DijkHop
-    {
-        DijkHop()
-            : Road(0), Time(-1), Position(-1), Weight(Inf)
-        { }
-        Road* Road;
-        int Time;
-        int Position;
-        int Weight;
-    };
-
-    struct DijWeight
-    {
-        DijWeight()
-            : Length(Inf), Road(-1)
-        { }
-        int Length;
-        int Road;
-        bool Dir;
-    };
-
-    /* Dijkstra weight */
-    static uint crossSize = 0;
-    static std::vector< std::vector<DijWeight> > dijkWeight;
-    static std::vector<DijkHop> dijkHopList;
-    static std::vector<bool> dijkVisitedList;
-    static std::vector<int> dijkPathLastCrossId;
-
-    if (Scenario::Crosses().size() != crossSize)
-    {
-        crossSize = Scenario::Crosses().size();
-        dijkWeight.resize(crossSize);
-        dijkHopList.resize(crossSize);
-        dijkVisitedList.resize(crossSize);
-        dijkPathLastCrossId.resize(crossSize);
-        for (uint iCross = 0; iCross < crossSize; ++iCross)
-        {
-            dijkWeight[iCross].resize(crossSize);
-            for (uint jCross = 0; jCross < crossSize; ++ jCross)
-            {
-                dijkWeight[iCross][jCross].Length = Inf;
-                dijkWeight[iCross][jCross].Road = -1;
-            }
-        }
-
-        for (uint i = 0; i < Scenario::Roads().size(); ++i)
-        {
-            Road* road = Scenario::Roads()[i];
-            dijkWeight[road->GetStartCrossId()][road->GetEndCrossId()].Length = road->GetLength();
-            dijkWeight[road->GetStartCrossId()][road->GetEndCrossId()].Road = i;
-            dijkWeight[road->GetStartCrossId()][road->GetEndCrossId()].Dir = true;
-            if (road->GetIsTwoWay())
-            {
-                dijkWeight[road->GetEndCrossId()][road->GetStartCrossId()].Length = road->GetLength();
-                dijkWeight[road->GetEndCrossId()][road->GetStartCrossId()].Road = i;
-                dijkWeight[road->GetEndCrossId()][road->GetStartCrossId()].Dir = false;
-            }
-        }
-    }
-
-    struct WeightLengthBackup
-    {
-        int FromCross;
-        int EndCross;
-        int BackupLength;
-    };
-
-    std::vector<WeightLengthBackup> backupLength;
-    //if (!car->GetIsInGarage())
-    {
-        backupLength.reserve(banedFirstHop.size());
-        Cross* currentCross = car->GetCurrentCross();
-        for (uint i = 0; i < banedFirstHop.size(); ++i)
-        {
-            Road* banedRoad = Scenario::Roads()[banedFirstHop[i]];
-            if (banedRoad->CanStartFrom(currentCross->GetId()))
-            {
-                Cross* peer = banedRoad->GetPeerCross(currentCross);
-                WeightLengthBackup backup;
-                backup.FromCross = currentCross->GetId();
-                backup.EndCross = peer->GetId();
-                backup.BackupLength = dijkWeight[backup.FromCross][backup.EndCross].Length;
-                backupLength.push_back(backup);
-                dijkWeight[backup.FromCross][backup.EndCross].Length = Inf;
-            }
-        }
-    }
-
-    Cross* fromCross = car->GetCar()->GetFromCross();
-    if (!car->GetIsInGarage())
-        fromCross = car->GetCurrentCross();
-    int from = fromCross->GetId();
-    int to = car->GetCar()->GetToCrossId();
-
-    //calculate
-    for (uint iCross = 0; iCross < crossSize; ++iCross)
-    {
-        dijkHopList[iCross].Weight = Inf;
-        dijkHopList[iCross].Time = Inf;
-        dijkPathLastCrossId[iCross] = -1;
-        dijkVisitedList[iCross] = false;
-    }
-    DirectionType_Foreach(dir,
-        Road* road = fromCross->GetRoad(dir);
-        if (road == 0) continue;
-        if (!road->CanStartFrom(fromCross->GetId())) continue;
-        Cross* peer = road->GetPeerCross(fromCross);
-        if (!Is_Inf(dijkWeight[fromCross->GetId()][peer->GetId()].Length))
-        {
-            if (car->GetIsInGarage())
-            {
-                dijkHopList[peer->GetId()].Time = firstHopTime;
-                double wba = WbaToLengthWeight(
-                    road->IsFromOrTo(fromCross->GetId()) ? m_carWeight[firstHopTime][road->GetId()].first : m_carWeight[firstHopTime][road->GetId()].second
-                    , m_roadCapacity[road->GetId()]);
-                dijkHopList[peer->GetId()].Weight = dijkWeight[fromCross->GetId()][peer->GetId()].Length + wba;
-                dijkHopList[peer->GetId()].Position = std::min(car->GetCar()->GetMaxSpeed(), road->GetLimit());
-            }
-            else
-            {
-                auto next = car->CalculateLeaveTime(car->GetCurrentRoad(), road, car->GetCurrentPosition());
-                int hopTime = firstHopTime + next.first - 1;
-                dijkHopList[peer->GetId()].Time = hopTime;
-                dijkHopList[peer->GetId()].Position = next.second;
-                double wba = 0;
-                if (hopTime < m_maxValidRange)
-                    wba = WbaToLengthWeight(
-                        road->IsFromOrTo(fromCross->GetId()) ? m_carWeight[hopTime][road->GetId()].first : m_carWeight[hopTime][road->GetId()].second
-                        , m_roadCapacity[road->GetId()]);
-                dijkHopList[peer->GetId()].Weight = dijkWeight[fromCross->GetId()][peer->GetId()].Length + wba;
-            }
-            dijkHopList[peer->GetId()].Road = road;
-            dijkPathLastCrossId[peer->GetId()] = from;
-        }
-    );
-    dijkPathLastCrossId[from] = from;
-    dijkHopList[from].Time = firstHopTime - 1;
-    dijkHopList[from].Position = car->GetIsInGarage() ? 0 : car->GetCurrentPosition();
-    dijkHopList[from].Weight = 0;
-    dijkVisitedList[from] = true;
-
-    for (uint iExtend = 0; iExtend < crossSize - 1; ++iExtend)
-    {
-        int min = Inf;
-        int visited = -1;
-        for (uint iMin = 0; iMin < crossSize; ++iMin)
-        {
-            if (!dijkVisitedList[iMin] && dijkHopList[iMin].Weight < min)
-            {
-                min = dijkHopList[iMin].Weight;
-                visited = iMin;
-            }
-        }
-
-        ASSERT(visited != -1);
-        dijkVisitedList[visited] = true;
-        int traceIndex = visited;
-        int traceSize = 0;
-        while (traceIndex != from)
-        {
-            traceSize++;
-            ASSERT(traceIndex >= 0 && traceIndex < dijkPathLastCrossId.size());
-            traceIndex = dijkPathLastCrossId[traceIndex];
-        }
-        Cross* visitedCross = Scenario::Crosses()[visited];
-        const auto& hop = dijkHopList[visited];
-        DirectionType_Foreach(dir, 
-            Road* road = visitedCross->GetRoad(dir);
-            if (road == 0) continue;
-            if (!road->CanStartFrom(visitedCross->GetId())) continue;
-            Cross* peerUpdate = road->GetPeerCross(visitedCross);
-            const auto& weight = dijkWeight[visited][peerUpdate->GetId()];
-            auto next = car->CalculateLeaveTime(hop.Road, road, hop.Position);
-            int reachTime = hop.Time + next.first;
-            double wba = 0;
-            if (reachTime < m_maxValidRange)
-                wba = WbaToLengthWeight(
-                    road->IsFromOrTo(visitedCross->GetId()) ? m_carWeight[reachTime][road->GetId()].first : m_carWeight[reachTime][road->GetId()].second
-                    , m_roadCapacity[road->GetId()]);
-            double sumWeight = min + dijkWeight[visited][peerUpdate->GetId()].Length + wba;
-            if (sumWeight < dijkHopList[peerUpdate->GetId()].Weight)
-            {
-                dijkHopList[peerUpdate->GetId()].Weight = sumWeight;
-                dijkHopList[peerUpdate->GetId()].Position = next.second;
-                dijkHopList[peerUpdate->GetId()].Road = road;
-                dijkHopList[peerUpdate->GetId()].Time = reachTime;
-                dijkPathLastCrossId[peerUpdate->GetId()] = visited;
-            }
-        );
-    }
-
-    car->GetTrace().Clear(car->GetCurrentTraceIndex());
-    std::vector<int> newTrace;
-    int endCrossId = to;
-    while (endCrossId != from)
-    {
-        ASSERT(dijkHopList[endCrossId].Road != 0);
-        ASSERT(dijkHopList[endCrossId].Road->CanReachTo(endCrossId));
-        newTrace.push_back(dijkHopList[endCrossId].Road->GetId());
-        endCrossId = dijkPathLastCrossId[endCrossId];
-    }
-    for (int i = newTrace.size() - 1; i >= 0; --i)
-        car->GetTrace().AddToTail(newTrace[i]);
-
-    //recorver
-    for (uint i = 0; i < backupLength.size(); ++i)
-    {
-        const auto& backup = backupLength[i];
-        dijkWeight[backup.FromCross][backup.EndCross].Length = backup.BackupLength;
-    }
+    bool ret = m_dijkstra.Search(car, firstHopTime, banedFirstHop, m_timeWeightCallback);
+    ASSERT_MSG(ret, "can not find the trace of car " << car->GetCar()->GetOriginId());
 
 #ifdef ASSERT_ON
     //check path valid
@@ -2,15 +2,20 @@
 #define SCHEDULER_TIMEWEIGHT_H
 
 #include "scheduler.h"
-#include <list>
 #include <vector>
 #include "dead-lock-solver.h"
+#include "recompute-gate.h"
+#include "time-dijkstra.h"
 
 class SchedulerTimeWeight : public Scheduler
 {
 public:
     SchedulerTimeWeight();
 
+    void SetRecomputeDeltaThreshold(double v); //[<0] (default) means recompute every 50 ticks or when garage is nearly empty
+    void SetRecomputeMaxInterval(int v); //recompute at least once in [v] ticks while a threshold is set, [<=0] (default) means no limit
+    void SetIsTimeAwareInitialTrace(bool v); //plan traces of cars in garage by time weight instead of static load
+
 protected:
     virtual void DoInitialize(SimScenario& scenario) override;
     virtual void DoUpdate(int& time, SimScenario& scenario) override;
@@ -21,35 +26,111 @@ private:
     /* factor array */
     static void InitilizeConfidence();
     //static std::vector< std::vector< std::vector<double> > > m_confidence; //confidence(deltaT, a, b) : binomial(N = a, k = b)
-    static std::vector< std::vector< std::vector<double> > > m_collectionWeight; //interface for update w'(a, b, delataT( <= b))
+    struct WeightBand //non-zero part of w'(a, b, deltaT), zero outside [Start, Start + Length)
+    {
+        WeightBand();
+        int Start;
+        int Length;
+        int Offset; //in m_collectionWeight
+        inline double Get(const double* data, const int& deltaT) const;
+    };//struct WeightBand
+    static std::vector<WeightBand> m_collectionBand; //a * m_maxValidRange + b -> band
+    static std::vector<double> m_collectionWeight; //interface for update w'(a, b, delataT( <= b)), bands one by one
     //static std::vector< std::pair<int, int> > m_significantRange; //deltaT -> start, length
     static int m_maxValidRange;
 
     int m_updateInterval;
+    RecomputeGate m_recomputeGate;
     std::vector< std::vector<SimCar*> > m_carList;
     DeadLockSolver m_deadLockSolver;
     std::pair<int, bool> SelectBestRoad(SimScenario& scenario, const std::vector<int>& list, SimCar* car);
 
-    /* time weight */
+    /* time weight, m_carWeight is a ring of time slots : absolute time % m_maxValidRange -> road -> weight */
     int m_carWeightStartTime;
     std::vector< std::vector< std::pair<double, double> > > m_carWeight;
+    struct CarWeightSegment
+    {
+        int Road;
+        bool Dir;
+        int StartTime;
+        int LeaveTime;
+    };//struct CarWeightSegment
+    struct CarWeightFootprint //what a car has added to m_carWeight
+    {
+        CarWeightFootprint();
+        int BaseTime; //[-1] means nothing added
+        int TraceIndex; //trace index of the first segment
+        bool IsInGarage;
+        int StartTime; //time of leaving the garage, or of being on the current road
+        int CoveredTime; //furthest time predicted, added again when the window passes it, [-1] means the whole trace
+        std::vector<CarWeightSegment> Segments; //empty if the car starts after the window
+    };//struct CarWeightFootprint
+    std::vector<CarWeightFootprint> m_carWeightFootprint; //car id -> footprint
+    struct PendingWeight //band of w' waiting to be added to m_carWeight
+    {
+        int DeltaStart;
+        int DeltaEnd;
+        int BaseTime;
+        bool IsDecrease;
+    };//struct PendingWeight
+    std::vector< std::vector<PendingWeight> > m_pendingWeight; //road id * 2 + (dir ? 0 : 1) -> waiting bands, added when the road is read
+    std::vector<double> m_fifoWeight; //(road id * 2 + (dir ? 0 : 1)) * m_maxValidRange + index -> road weight for dijkstra, index + weight never decreases
+    std::vector<bool> m_isFifoWeightValid; //road id * 2 + (dir ? 0 : 1) -> no change of m_carWeight since m_fifoWeight was built
     std::vector<int> m_roadWeight; //basic weight
     std::vector<int> m_roadCapacity; //capacity limit
     std::vector< std::pair<double, double> > m_threshold; //number of lane -> ignore threshold & ban threshold
     std::vector< std::vector<double> > m_expectedWeight; //decide if need change trace
-    std::vector< std::vector< std::pair< std::list<int>, int> > > m_bestTrace; //start -> end : trace & length
+    struct BestTrace
+    {
+        int Offset; //in m_bestTraceRoads
+        int Size;
+        int Length;
+    };//struct BestTrace
+    std::vector<BestTrace> m_bestTrace; //start * number of crosses + end -> trace & length
+    std::vector<int> m_bestTraceRoads; //all best traces one by one
+
+    /* dijkstra */
+    TimeDijkstra m_dijkstra;
+    TimeDijkstra::WeightCallback m_timeWeightCallback;
+    TimeDijkstra::WeightCallback m_loadWeightCallback;
+    std::vector< std::vector<double> > m_loadWeight; //cross -> cross : static weight for initializing traces
+    bool m_isTimeAwareInitialTrace;
+    double GetRoadWeightByTime(int time, Road* road, Cross* from); //FIFO, see m_fifoWeight
+    const double* GetFifoWeight(Road* road, const bool& dir);
+    double GetRoadWeightByLoad(int time, Road* road, Cross* from);
 
     void InitializeBestTraceByFloyd();
     void InitializeCarTraceByBeastTrace(SimScenario& scenario);
     void InitializeCarTraceByDijkstra(SimScenario& scenario);
-    bool IsAppropriateToDispatch(const int& time, SimCar* car, SimScenario& scenario) const;
+    bool IsAppropriateToDispatch(const int& time, SimCar* car, SimScenario& scenario);
 
     void UpdateTimeWeight(const int& time, SimScenario& scenario);
     void UpdateTimeWeightByRoadAndTime(const int& time, const int& roadId, const bool& dir, int startTime, int leaveTime, const bool& isDecrease);
-    void UpdateTimeWeightForEachCar(const int& time, SimCar* car, const bool& isDecrease = false);
+    void ApplyTimeWeight(const PendingWeight& pending, const int& roadId, const bool& dir, std::vector< std::vector< std::pair<double, double> > >& carWeight) const;
+    void FlushTimeWeight(const int& roadId, const bool& dir);
+    double GetCarWeight(const int& index, const int& roadId, const bool& dir); //[index] : time from m_carWeightStartTime
+    void UpdateTimeWeightForEachCar(const int& time, SimCar* car, const bool& isDecrease = false); //decrease removes exactly the last footprint
+    bool IsCarWeightCounted(SimCar* car) const;
+    bool IsCarWeightChanged(const int& time, SimCar* car) const;
+    void CheckCarWeight(SimScenario& scenario); //compare with a rebuild from the footprints of counted cars
+    inline int GetCarWeightSlot(const int& index) const; //[index] : time from m_carWeightStartTime
     void UpdateCurrentWeightByScenario(const int& time, SimScenario& scenario);
-    bool UpdateCarTraceByDijkstraWithTimeWeight(const int& time, SimScenario& scenario, SimCar* car, const std::vector<int>& banedFirstHop = std::vector<int>()) const;
+    bool UpdateCarTraceByDijkstraWithTimeWeight(const int& time, SimScenario& scenario, SimCar* car, const std::vector<int>& banedFirstHop = std::vector<int>());
+
+    friend class MicroBench; //runs the kernels alone
 
 };
 
+inline int SchedulerTimeWeight::GetCarWeightSlot(const int& index) const
+{
+    return (m_carWeightStartTime + index) % m_maxValidRange;
+}
+
+inline double SchedulerTimeWeight::WeightBand::Get(const double* data, const int& deltaT) const
+{
+    if (deltaT < Start || deltaT >= Start + Length)
+        return 0;
+    return data[Offset + deltaT - Start];
+}
+
 #endif
\ No newline at end of file
@@ -2,32 +2,41 @@
 #include "log.h"
 #include "timer.h"
 #include "assert.h"
+#include "profiler.h"
 
 Scheduler::Scheduler()
-    : m_traceFile(0)
+    : m_cancelToken(0)
 { }
 
 Scheduler::~Scheduler()
 {
-    if (m_traceFile != 0)
-    {
-        m_traceFile->flush();
-        m_traceFile->close();
-        delete m_traceFile;
-    }
+    m_traceWriter.Close();
+    m_metricsWriter.Close();
     m_memoryPool.Release();
 }
 
-void Scheduler::EnableTrace(const std::string& traceFile)
+void Scheduler::EnableTrace(const std::string& traceFile, bool isCompress)
 {
     ASSERT(traceFile.length() > 0);
-    if (m_traceFile != 0)
-    {
-        m_traceFile->flush();
-        m_traceFile->close();
-        delete m_traceFile;
-    }
-    m_traceFile = new std::ofstream(traceFile.c_str());
+    bool isOpen = m_traceWriter.Open(traceFile.c_str(), isCompress);
+    ASSERT_MSG(isOpen, "can not open trace file " << traceFile);
+}
+
+void Scheduler::EnableMetrics(const std::string& metricsFile, const TickMetricsWriter::Format& format)
+{
+    ASSERT(metricsFile.length() > 0);
+    bool isOpen = m_metricsWriter.Open(metricsFile.c_str(), format);
+    ASSERT_MSG(isOpen, "can not open metrics file " << metricsFile);
+}
+
+void Scheduler::SetCancelToken(const CancelToken* token)
+{
+    m_cancelToken = token;
+}
+
+bool Scheduler::IsCancelled() const
+{
+    return m_cancelToken != 0 && m_cancelToken->IsCancelled();
 }
 
 void Scheduler::Initialize(SimScenario& scenario)
@@ -37,71 +46,21 @@ void Scheduler::Initialize(SimScenario& scenario)
 
 void Scheduler::Update(int& time, SimScenario& scenario)
 {
+    PROFILE_ZONE("scheduler.update");
     DoUpdate(time, scenario);
 }
 
 void Scheduler::HandleResult(int& time, SimScenario& scenario, Simulator::UpdateResult& result)
 {
+    PROFILE_ZONE("scheduler.result");
     if (Log::Get<LoadState>())
     {
         m_loadState.Update(time, scenario);
         if (scenario.IsComplete())
             m_loadState.Print(scenario);
     }
-    if (m_traceFile != 0)
-    {
-        std::ostream& os = *m_traceFile;
-        os << "time:" << time << "\n";
-        for (uint iRoad = 0; iRoad < scenario.Roads().size(); ++iRoad)
-        {
-            SimRoad* road = scenario.Roads()[iRoad];
-            os << "(" << road->GetRoad()->GetOriginId() << ",";
-            os << "forward,[";
-            int length = road->GetRoad()->GetLength();
-            for (int i = 1; i <= road->GetRoad()->GetLanes(); ++i)
-            {
-                os << (i == 1 ? "" : ",") << "[";
-                auto& cars = road->GetCars(i);
-                int index = length;
-                for (auto carIte = cars.begin(); carIte != cars.end(); ++carIte)
-                {
-                    int pos = scenario.Cars()[(*carIte)->GetId()]->GetCurrentPosition();
-                    for (; index > pos; --index)
-                        os << (index == length ? "" : ",") << "-1";
-                    os << (index == length ? "" : ",") << (*carIte)->GetOriginId();
-                    --index;
-                }
-                for (; index > 0; --index)
-                    os << (index == length ? "" : ",") << "-1";
-                os << "]";
-            }
-            os << "])";
-            if (road->GetRoad()->GetIsTwoWay())
-            {
-                os << "\n(" << road->GetRoad()->GetOriginId() << ",";
-                os << "backward,[";
-                for (int i = 1; i <= road->GetRoad()->GetLanes(); ++i)
-                {
-                    os << (i == 1 ? "" : ",") << "[";
-                    auto& cars = road->GetCarsOpposite(i);
-                    int index = length;
-                    for (auto carIte = cars.begin(); carIte != cars.end(); ++carIte)
-                    {
-                        int pos = scenario.Cars()[(*carIte)->GetId()]->GetCurrentPosition();
-                        for (; index > pos; --index)
-                            os << (index == length ? "" : ",") << "-1";
-                        os << (index == length ? "" : ",") << (*carIte)->GetOriginId();
-                        --index;
-                    }
-                    for (; index > 0; --index)
-                        os << (index == length ? "" : ",") << "-1";
-                    os << "]";
-                }
-                os << "])";
-            }
-            os << std::endl;
-        }
-    }
+    m_traceWriter.Record(time, scenario);
+    m_metricsWriter.Record(time, result);
     DoHandleResult(time, scenario, result);
 }
 
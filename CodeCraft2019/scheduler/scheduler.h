@@ -7,7 +7,9 @@
 #include "memory-pool.h"
 #include "timer.h"
 #include "load-state.h"
-#include <fstream>
+#include "binary-trace.h"
+#include "tick-metrics.h"
+#include "deadline.h"
 
 class Scheduler
 {
@@ -16,7 +18,9 @@ protected:
 
 public:
     virtual ~Scheduler();
-    void EnableTrace(const std::string& traceFile);
+    void EnableTrace(const std::string& traceFile, bool isCompress = false); //binary trace, see BinaryTrace
+    void EnableMetrics(const std::string& metricsFile, const TickMetricsWriter::Format& format); //counters of each tick
+    void SetCancelToken(const CancelToken* token); //long loops return early once it is cancelled, [0] means never
 
     void Initialize(SimScenario& scenario);
     void Update(int& time, SimScenario& scenario); //before simulator update
@@ -33,13 +37,17 @@ protected:
     virtual void DoHandleBecomeFirstPriority(const int& time, SimScenario& scenario, SimCar* car);
     virtual void DoHandleResult(int& time, SimScenario& scenario, Simulator::UpdateResult& result);
 
+    bool IsCancelled() const;
+
     MemoryPool m_memoryPool;
 
 private:
     /* for statistic */
     LoadState m_loadState;
 
-    std::ofstream* m_traceFile;
+    BinaryTraceWriter m_traceWriter;
+    TickMetricsWriter m_metricsWriter;
+    const CancelToken* m_cancelToken;
 
 };//class Scheduler
 
@@ -0,0 +1,122 @@
+#include "time-dijkstra.h"
+#include "scenario.h"
+#include "assert.h"
+#include <algorithm>
+
+TimeDijkstra::TimeDijkstra()
+{ }
+
+void TimeDijkstra::Initialize()
+{
+    uint crossSize = Scenario::Crosses().size();
+    m_hops.resize(crossSize);
+    m_heap.clear();
+    m_heap.reserve(Scenario::Roads().size() * 2 + 1); //each road is relaxed at most once in each direction
+    m_path.clear();
+    m_path.reserve(crossSize);
+}
+
+inline void TimeDijkstra::Push(const double& weight, const int& cross)
+{
+    HeapNode node;
+    node.Weight = weight;
+    node.CrossId = cross;
+    m_heap.push_back(node);
+    std::push_heap(m_heap.begin(), m_heap.end());
+}
+
+bool TimeDijkstra::Search(SimCar* car, const int& firstHopTime, const std::vector<int>& banedFirstHop, const WeightCallback& weight)
+{
+    ASSERT(!car->GetIsReachedGoal());
+    ASSERT(!weight.IsNull());
+    ASSERT(m_hops.size() == Scenario::Crosses().size());
+
+    bool isInGarage = car->GetIsInGarage();
+    Cross* fromCross = isInGarage ? car->GetCar()->GetFromCross() : car->GetCurrentCross();
+    int from = fromCross->GetId();
+    int to = car->GetCar()->GetToCrossId();
+
+    for (uint i = 0; i < m_hops.size(); ++i)
+    {
+        Hop& hop = m_hops[i];
+        hop.Weight = Inf;
+        hop.Time = Inf;
+        hop.Position = -1;
+        hop.LastRoad = 0;
+        hop.LastCross = -1;
+        hop.Visited = false;
+    }
+    m_heap.clear();
+
+    Hop& start = m_hops[from];
+    start.Weight = 0;
+    start.Time = firstHopTime - 1;
+    start.Position = isInGarage ? 0 : car->GetCurrentPosition();
+    start.LastRoad = isInGarage ? 0 : car->GetCurrentRoad();
+    start.LastCross = from;
+    Push(0, from);
+
+    while (m_heap.size() > 0)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end());
+        HeapNode node = m_heap.back();
+        m_heap.pop_back();
+        Hop& hop = m_hops[node.CrossId];
+        if (hop.Visited || node.Weight > hop.Weight)
+            continue; //out of date
+        hop.Visited = true;
+        if (node.CrossId == to)
+            break;
+
+        Cross* cross = Scenario::Crosses()[node.CrossId];
+        for (int dir = (int)Cross::NORTH; dir <= (int)Cross::WEST; ++dir)
+        {
+            Road* road = cross->GetRoad((Cross::DirectionType)dir);
+            if (road == 0) continue;
+            if (!road->CanStartFrom(cross->GetId())) continue;
+            if (node.CrossId == from && std::find(banedFirstHop.begin(), banedFirstHop.end(), road->GetId()) != banedFirstHop.end())
+                continue;
+            Cross* peer = road->GetPeerCross(cross);
+            Hop& peerHop = m_hops[peer->GetId()];
+            if (peerHop.Visited) continue;
+
+            std::pair<int, int> next;
+            if (hop.LastRoad == 0) //get out from garage
+                next = std::make_pair(1, std::min(car->GetCar()->GetMaxSpeed(), road->GetLimit()));
+            else
+                next = car->CalculateLeaveTime(hop.LastRoad, road, hop.Position);
+            int reachTime = hop.Time + next.first;
+            ASSERT(reachTime > hop.Time);
+            double roadWeight = weight.Invoke(reachTime, road, cross);
+#ifdef _DEBUG
+            ASSERT(reachTime <= 0 || reachTime + roadWeight >= reachTime - 1 + weight.Invoke(reachTime - 1, road, cross) - 1e-6); //FIFO
+#endif
+            double sumWeight = hop.Weight + roadWeight;
+            if (sumWeight < peerHop.Weight)
+            {
+                peerHop.Weight = sumWeight;
+                peerHop.Time = reachTime;
+                peerHop.Position = next.second;
+                peerHop.LastRoad = road;
+                peerHop.LastCross = node.CrossId;
+                Push(sumWeight, peer->GetId());
+            }
+        }
+    }
+    if (!m_hops[to].Visited)
+        return false;
+
+    //rebuild the trace after current trace index
+    m_path.clear();
+    for (int crossId = to; crossId != from; crossId = m_hops[crossId].LastCross)
+    {
+        ASSERT(m_hops[crossId].LastRoad != 0);
+        ASSERT(m_hops[crossId].LastRoad->CanReachTo(crossId));
+        m_path.push_back(m_hops[crossId].LastRoad->GetId());
+    }
+    Trace& trace = car->GetTrace();
+    trace.Clear(car->GetCurrentTraceIndex());
+    for (int i = (int)m_path.size() - 1; i >= 0; --i)
+        trace.AddToTail(m_path[i]);
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef TIME_DIJKSTRA_H
+#define TIME_DIJKSTRA_H
+
+#include "sim-car.h"
+#include "callback.h"
+#include <vector>
+
+/*
+ * time dependent dijkstra for a single car
+ *   the weight of a road is asked when the car is expected to reach it, so it can change along the time
+ *   weights must be FIFO : time + weight never decreases when time grows, or a label settled early is not the best
+ *   binary heap with lazy deletion, all buffers are kept between searches
+ */
+class TimeDijkstra
+{
+public:
+    typedef Callback::Handle3<double, int, Road*, Cross*> WeightCallback; //(time of reaching, road, from cross) -> weight of the road
+
+    TimeDijkstra();
+
+    void Initialize(); //build buffers for the crosses in scenario
+
+    /* rewrite the trace of [car] after its current trace index, [firstHopTime] : when the car can get on next road */
+    bool Search(SimCar* car, const int& firstHopTime, const std::vector<int>& banedFirstHop, const WeightCallback& weight);
+
+private:
+    struct Hop
+    {
+        double Weight;
+        int Time; //time of leaving the last road
+        int Position; //position on this road after first step
+        Road* LastRoad; //road to reach this cross
+        int LastCross;
+        bool Visited;
+    };//struct Hop
+
+    struct HeapNode
+    {
+        double Weight;
+        int CrossId;
+        inline bool operator < (const HeapNode& o) const; //as a min heap
+    };//struct HeapNode
+
+    std::vector<Hop> m_hops; //cross id -> hop
+    std::vector<HeapNode> m_heap;
+    std::vector<int> m_path;
+
+    inline void Push(const double& weight, const int& cross);
+
+};//class TimeDijkstra
+
+inline bool TimeDijkstra::HeapNode::operator < (const HeapNode& o) const
+{
+    if (Weight != o.Weight)
+        return Weight > o.Weight;
+    return CrossId > o.CrossId;
+}
+
+#endif
@@ -0,0 +1,309 @@
+#include "binary-trace.h"
+#include "sim-scenario.h"
+#include "lz-block.h"
+#include "assert.h"
+#include <cstring>
+
+const int BinaryTrace::Magic(0x52544343); //"CCTR"
+const char BinaryTrace::Version(1);
+const std::size_t BinaryTrace::BlockSize(1 << 16);
+const std::size_t BinaryTrace::MaxBlockSize(1 << 26);
+
+const int FileHeaderSize = sizeof(int) + 2;
+
+BinaryTraceWriter::BinaryTraceWriter()
+    : m_writer(1 << 20, AsyncWriter::BLOCK), m_isCompress(false), m_isTopologyWritten(false), m_lastTime(0)
+{ }
+
+BinaryTraceWriter::~BinaryTraceWriter()
+{
+    Close();
+}
+
+bool BinaryTraceWriter::Open(const char* file, bool isCompress)
+{
+    Close();
+    if (!m_writer.Open(file))
+        return false;
+    m_isCompress = isCompress;
+    m_isTopologyWritten = false;
+    m_lastTime = 0;
+    m_lanes.clear();
+    m_carPositions.clear();
+    m_block.clear();
+    m_block.reserve(BinaryTrace::BlockSize * 2);
+    char header[FileHeaderSize];
+    memcpy(header, &BinaryTrace::Magic, sizeof(int));
+    header[sizeof(int)] = BinaryTrace::Version;
+    header[sizeof(int) + 1] = isCompress ? BinaryTrace::FLAG_COMPRESS : 0;
+    m_writer.Write(header, FileHeaderSize);
+    return true;
+}
+
+void BinaryTraceWriter::Close()
+{
+    if (!m_writer.GetIsOpen())
+        return;
+    Flush();
+    m_writer.Close();
+}
+
+void BinaryTraceWriter::WriteTopology(const SimScenario& scenario)
+{
+    const std::vector<SimRoad*>& roads = scenario.Roads();
+    int lanesN = 0;
+    WriteVarint(roads.size());
+    for (unsigned int i = 0; i < roads.size(); ++i)
+    {
+        Road* road = roads[i]->GetRoad();
+        WriteSigned(road->GetOriginId());
+        WriteVarint(road->GetLength());
+        WriteVarint(road->GetLanes());
+        WriteVarint(road->GetIsTwoWay() ? 1 : 0);
+        lanesN += road->GetIsTwoWay() ? road->GetLanes() * 2 : road->GetLanes();
+    }
+    const std::vector<SimCar*>& cars = scenario.Cars();
+    WriteVarint(cars.size());
+    for (unsigned int i = 0; i < cars.size(); ++i)
+        WriteSigned(cars[i]->GetCar()->GetOriginId());
+    Flush(); //the topology is a block of its own
+    m_lanes.assign(lanesN, std::vector<int>());
+    m_carPositions.assign(cars.size(), 0);
+    m_isTopologyWritten = true;
+}
+
+void BinaryTraceWriter::Record(const int& time, const SimScenario& scenario)
+{
+    if (!m_writer.GetIsOpen())
+        return;
+    if (!m_isTopologyWritten)
+        WriteTopology(scenario);
+    WriteSigned(time - m_lastTime);
+    m_lastTime = time;
+    int laneIndex = 0;
+    int lastChanged = -1;
+    const std::vector<SimRoad*>& roads = scenario.Roads();
+    for (unsigned int iRoad = 0; iRoad < roads.size(); ++iRoad)
+    {
+        SimRoad* road = roads[iRoad];
+        int directionsN = road->GetRoad()->GetIsTwoWay() ? 2 : 1;
+        for (int direction = 0; direction < directionsN; ++direction)
+        {
+            for (int lane = 1; lane <= road->GetRoad()->GetLanes(); ++lane, ++laneIndex)
+            {
+                const std::vector<Car*>& cars = road->GetCars(lane, direction != 0);
+                std::vector<int>& last = m_lanes[laneIndex];
+                m_current.clear();
+                for (unsigned int i = 0; i < cars.size(); ++i)
+                {
+                    m_current.push_back(cars[i]->GetId());
+                    m_current.push_back(scenario.Cars()[cars[i]->GetId()]->GetCurrentPosition());
+                }
+                if (m_current == last)
+                    continue;
+                //cars leaving the front shift the rest, align the first car with its slot of the last frame
+                int carsN = m_current.size() / 2;
+                int lastN = last.size() / 2;
+                int shift = 0;
+                if (carsN > 0)
+                    for (; shift < lastN && last[shift * 2] != m_current[0]; ++shift) { }
+                if (shift == lastN)
+                    shift = 0;
+                WriteVarint(laneIndex - lastChanged);
+                WriteVarint(carsN);
+                WriteVarint(shift);
+                for (int i = 0; i < carsN; ++i)
+                {
+                    int id = m_current[i * 2];
+                    int baseId = i + shift < lastN ? last[(i + shift) * 2] : (i > 0 ? m_current[i * 2 - 2] : 0);
+                    WriteSigned(id - baseId);
+                    WriteSigned(m_current[i * 2 + 1] - m_carPositions[id]);
+                    m_carPositions[id] = m_current[i * 2 + 1];
+                }
+                last.swap(m_current);
+                lastChanged = laneIndex;
+            }
+        }
+    }
+    WriteVarint(0);
+    //raw frames go to the writer at once, so a crash loses nothing; compression needs larger blocks
+    if (!m_isCompress || m_block.size() >= BinaryTrace::BlockSize)
+        Flush();
+}
+
+void BinaryTraceWriter::Flush()
+{
+    if (m_block.size() == 0)
+        return;
+    int header[3] = { (int)m_block.size(), (int)m_block.size(), BinaryTrace::RAW };
+    const char* data = &m_block[0];
+    if (m_isCompress)
+    {
+        m_compressed.clear();
+        std::size_t size = LzBlock::Compress(&m_block[0], m_block.size(), m_compressed);
+        if (size < m_block.size())
+        {
+            header[1] = size;
+            header[2] = BinaryTrace::LZ;
+            data = &m_compressed[0];
+        }
+    }
+    m_writer.Write(header, sizeof(header));
+    m_writer.Write(data, header[1]);
+    m_block.clear();
+}
+
+BinaryTraceReader::BinaryTraceReader()
+    : m_file(0), m_isBroken(false), m_blockSize(0), m_cursor(0), m_time(0)
+{ }
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+    Close();
+}
+
+bool BinaryTraceReader::Open(const char* file)
+{
+    Close();
+    m_isBroken = false;
+    m_blockSize = 0;
+    m_cursor = 0;
+    m_time = 0;
+    m_file = fopen(file, "rb");
+    if (m_file == 0)
+        return false;
+    char header[FileHeaderSize];
+    int magic;
+    if (fread(header, 1, FileHeaderSize, m_file) != (std::size_t)FileHeaderSize
+        || (memcpy(&magic, header, sizeof(int)), magic != BinaryTrace::Magic)
+        || header[sizeof(int)] != BinaryTrace::Version
+        || !ReadBlock()
+        || !ReadTopology())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void BinaryTraceReader::Close()
+{
+    if (m_file != 0)
+        fclose(m_file);
+    m_file = 0;
+    m_roads.clear();
+    m_carOriginIds.clear();
+    m_lanes.clear();
+    m_changedLanes.clear();
+    m_carPositions.clear();
+}
+
+bool BinaryTraceReader::Fail()
+{
+    m_isBroken = true;
+    return false;
+}
+
+bool BinaryTraceReader::ReadBlock()
+{
+    int header[3];
+    std::size_t read = fread(header, sizeof(int), 3, m_file);
+    if (read == 0 && feof(m_file))
+        return false; //end of file
+    if (read != 3 || header[0] <= 0 || header[1] <= 0
+        || (std::size_t)header[0] > BinaryTrace::MaxBlockSize || (std::size_t)header[1] > BinaryTrace::MaxBlockSize)
+        return Fail(); //truncated, the writer may have been killed
+    m_blockSize = header[0];
+    m_cursor = 0;
+    if (m_block.size() < m_blockSize)
+        m_block.resize(m_blockSize);
+    if (header[2] == BinaryTrace::RAW)
+    {
+        if (header[1] != header[0] || fread(&m_block[0], 1, m_blockSize, m_file) != m_blockSize)
+            return Fail();
+        return true;
+    }
+    if (header[2] != BinaryTrace::LZ)
+        return Fail();
+    m_stored.resize(header[1]);
+    if (fread(&m_stored[0], 1, m_stored.size(), m_file) != m_stored.size()
+        || !LzBlock::Decompress(&m_stored[0], m_stored.size(), &m_block[0], m_blockSize))
+        return Fail();
+    return true;
+}
+
+bool BinaryTraceReader::ReadTopology()
+{
+    unsigned int roadsN, carsN, value;
+    if (!ReadVarint(roadsN))
+        return Fail();
+    int lanesN = 0;
+    m_roads.resize(roadsN);
+    for (unsigned int i = 0; i < roadsN; ++i)
+    {
+        BinaryTrace::TraceRoad& road = m_roads[i];
+        unsigned int length, lanes;
+        if (!ReadSigned(road.OriginId) || !ReadVarint(length) || !ReadVarint(lanes) || !ReadVarint(value))
+            return Fail();
+        road.Length = length;
+        road.Lanes = lanes;
+        road.IsTwoWay = value != 0;
+        road.FirstLane = lanesN;
+        lanesN += road.IsTwoWay ? road.Lanes * 2 : road.Lanes;
+    }
+    if (!ReadVarint(carsN))
+        return Fail();
+    m_carOriginIds.resize(carsN);
+    for (unsigned int i = 0; i < carsN; ++i)
+        if (!ReadSigned(m_carOriginIds[i]))
+            return Fail();
+    if (m_cursor != m_blockSize)
+        return Fail();
+    m_lanes.assign(lanesN, std::vector<int>());
+    m_carPositions.assign(carsN, 0);
+    return true;
+}
+
+bool BinaryTraceReader::Next()
+{
+    if (m_file == 0 || m_isBroken)
+        return false;
+    if (m_cursor >= m_blockSize && !ReadBlock())
+        return false;
+    m_changedLanes.clear();
+    int delta;
+    if (!ReadSigned(delta))
+        return Fail();
+    m_time += delta;
+    int laneIndex = -1;
+    while (true)
+    {
+        unsigned int gap, carsN, shift;
+        if (!ReadVarint(gap))
+            return Fail();
+        if (gap == 0)
+            break;
+        laneIndex += gap;
+        if (laneIndex >= (int)m_lanes.size() || !ReadVarint(carsN) || !ReadVarint(shift))
+            return Fail();
+        std::vector<int>& last = m_lanes[laneIndex];
+        unsigned int lastN = last.size() / 2;
+        m_current.clear();
+        for (unsigned int i = 0; i < carsN; ++i)
+        {
+            int idDelta, positionDelta;
+            if (!ReadSigned(idDelta) || !ReadSigned(positionDelta))
+                return Fail();
+            int baseId = i + shift < lastN ? last[(i + shift) * 2] : (i > 0 ? m_current[i * 2 - 2] : 0);
+            int id = baseId + idDelta;
+            if (id < 0 || id >= (int)m_carPositions.size())
+                return Fail();
+            m_carPositions[id] += positionDelta;
+            m_current.push_back(id);
+            m_current.push_back(m_carPositions[id]);
+        }
+        last.swap(m_current);
+        m_changedLanes.push_back(laneIndex);
+    }
+    return true;
+}
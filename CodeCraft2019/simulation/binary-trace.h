@@ -0,0 +1,225 @@
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include "async-writer.h"
+
+class SimScenario;
+
+/*
+ * compact replacement of the text trace (log.tr)
+ *   file   : magic "CCTR", version, flags, then blocks
+ *   block  : raw size, stored size, codec (3 ints), then the bytes, compressed by LzBlock if codec is LZ
+ *   first block is the topology : roads (origin id, length, lanes, is two way) and origin ids of cars
+ *   other blocks hold whole frames, one frame for each HandleResult, time may go back after a roll back
+ *   frame  : time delta, then every directed lane changed since the last frame :
+ *            lane index gap + 1, cars number, shift, (car id delta, position delta) for each car, ended by 0
+ *   directed lanes are ordered by road, forward lanes [1~lanes] first, then backward ones of two way roads
+ *   car ids are indexes of Scenario, delta against the car at the same slot of the last frame (after shift),
+ *   positions are delta against the last position of the same car
+ * the writer hands blocks to an AsyncWriter, so the simulation does not wait for the disk
+ */
+class BinaryTrace
+{
+public:
+    const static int Magic;
+    const static char Version;
+    const static std::size_t BlockSize; //a compressed block is flushed once it is larger than this, raw blocks hold one frame
+    const static std::size_t MaxBlockSize; //larger blocks are treated as broken data
+
+    enum Codec
+    {
+        RAW,
+        LZ
+    };
+
+    enum Flag
+    {
+        FLAG_COMPRESS = 1
+    };
+
+    struct TraceRoad
+    {
+        int OriginId;
+        int Length;
+        int Lanes;
+        bool IsTwoWay;
+        int FirstLane; //index of the first directed lane
+    };
+
+private:
+    BinaryTrace();
+    virtual ~BinaryTrace() = 0;
+
+};//class BinaryTrace
+
+class BinaryTraceWriter
+{
+public:
+    BinaryTraceWriter();
+    ~BinaryTraceWriter();
+
+    bool Open(const char* file, bool isCompress = false);
+    void Close(); //write all frames left
+    void Record(const int& time, const SimScenario& scenario); //the topology is written with the first frame
+    inline bool GetIsOpen() const;
+
+private:
+    BinaryTraceWriter(const BinaryTraceWriter& o); //not copyable
+    BinaryTraceWriter& operator = (const BinaryTraceWriter& o);
+
+    void WriteTopology(const SimScenario& scenario);
+    void Flush();
+    inline void WriteVarint(unsigned int value);
+    inline void WriteSigned(const int& value);
+
+    AsyncWriter m_writer;
+    bool m_isCompress;
+    bool m_isTopologyWritten;
+    int m_lastTime;
+    std::vector<char> m_block;
+    std::vector<char> m_compressed;
+    std::vector< std::vector<int> > m_lanes; //directed lane -> car id, position pairs of the last frame
+    std::vector<int> m_current;
+    std::vector<int> m_carPositions; //car id -> last written position
+
+};//class BinaryTraceWriter
+
+/*
+ * streams frames of a binary trace, only one block and the current state of lanes are in memory
+ */
+class BinaryTraceReader
+{
+public:
+    BinaryTraceReader();
+    ~BinaryTraceReader();
+
+    bool Open(const char* file); //read the topology
+    void Close();
+    bool Next(); //read the next frame, [false] at the end of file or on broken data
+    inline const bool& GetIsBroken() const;
+
+    inline const int& GetTime() const;
+    inline const std::vector<BinaryTrace::TraceRoad>& GetRoads() const;
+    inline const std::vector<int>& GetCarOriginIds() const;
+    inline int GetLanesN() const;
+    inline const std::vector<int>& GetLane(const int& index) const; //car id, position pairs from the front
+    inline const std::vector<int>& GetChangedLanes() const; //directed lanes changed by the last frame
+
+private:
+    BinaryTraceReader(const BinaryTraceReader& o); //not copyable
+    BinaryTraceReader& operator = (const BinaryTraceReader& o);
+
+    bool ReadBlock();
+    bool ReadTopology();
+    inline bool ReadVarint(unsigned int& value);
+    inline bool ReadSigned(int& value);
+    bool Fail();
+
+    FILE* m_file;
+    bool m_isBroken;
+    std::vector<char> m_block;
+    std::vector<char> m_stored;
+    std::size_t m_blockSize;
+    std::size_t m_cursor;
+    int m_time;
+    std::vector<BinaryTrace::TraceRoad> m_roads;
+    std::vector<int> m_carOriginIds;
+    std::vector< std::vector<int> > m_lanes;
+    std::vector<int> m_changedLanes;
+    std::vector<int> m_carPositions;
+    std::vector<int> m_current;
+
+};//class BinaryTraceReader
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline bool BinaryTraceWriter::GetIsOpen() const
+{
+    return m_writer.GetIsOpen();
+}
+
+inline void BinaryTraceWriter::WriteVarint(unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        m_block.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    m_block.push_back((char)value);
+}
+
+inline void BinaryTraceWriter::WriteSigned(const int& value)
+{
+    WriteVarint(((unsigned int)value << 1) ^ (unsigned int)(value >> 31)); //zigzag
+}
+
+inline const bool& BinaryTraceReader::GetIsBroken() const
+{
+    return m_isBroken;
+}
+
+inline const int& BinaryTraceReader::GetTime() const
+{
+    return m_time;
+}
+
+inline const std::vector<BinaryTrace::TraceRoad>& BinaryTraceReader::GetRoads() const
+{
+    return m_roads;
+}
+
+inline const std::vector<int>& BinaryTraceReader::GetCarOriginIds() const
+{
+    return m_carOriginIds;
+}
+
+inline int BinaryTraceReader::GetLanesN() const
+{
+    return m_lanes.size();
+}
+
+inline const std::vector<int>& BinaryTraceReader::GetLane(const int& index) const
+{
+    return m_lanes[index];
+}
+
+inline const std::vector<int>& BinaryTraceReader::GetChangedLanes() const
+{
+    return m_changedLanes;
+}
+
+inline bool BinaryTraceReader::ReadVarint(unsigned int& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (m_cursor >= m_blockSize)
+            return false;
+        unsigned char c = (unsigned char)m_block[m_cursor++];
+        value |= (unsigned int)(c & 0x7f) << shift;
+        if (c < 0x80)
+            return true;
+    }
+    return false;
+}
+
+inline bool BinaryTraceReader::ReadSigned(int& value)
+{
+    unsigned int u;
+    if (!ReadVarint(u))
+        return false;
+    value = (int)(u >> 1) ^ -(int)(u & 1);
+    return true;
+}
+
+#endif
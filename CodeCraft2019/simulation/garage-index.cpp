@@ -0,0 +1,201 @@
+#include "garage-index.h"
+#include "sim-car.h"
+#include "scenario.h"
+#include "assert.h"
+#include <algorithm>
+
+GarageIndex::GarageIndex()
+    : m_readyTime(-1)
+{ }
+
+inline int GarageIndex::GetListIndex(const SimCar* car) const
+{
+    return car->GetCar()->GetFromCrossId() * 2 + (car->GetCar()->GetIsVip() ? 1 : 0);
+}
+
+inline bool GarageIndex::IsValid(const Entry& entry) const
+{
+    return m_readyKey[entry.CarId] >= 0 && m_sequence[entry.CarId] == entry.Sequence;
+}
+
+inline GarageIndex::Entry GarageIndex::MakeEntry(SimCar* car) const
+{
+    Entry entry = { car->GetRealTime(), car->GetCar()->GetOriginId(), car, car->GetCar()->GetId(), 0 };
+    return entry;
+}
+
+void GarageIndex::Build(const std::vector<SimCar*>& cars, const int& crossesN)
+{
+    m_ready.clear();
+    m_ready.resize(crossesN * 2);
+    m_late.clear();
+    m_late.resize(crossesN * 2);
+    m_isDirty.clear();
+    m_isDirty.resize(crossesN * 2, false);
+    m_arrivedIndex.clear();
+    m_arrivedIndex.resize(crossesN * 2, 0);
+    m_calendar.clear();
+    m_readyKey.clear();
+    m_readyKey.resize(Scenario::Cars().size(), -1);
+    m_sequence.clear();
+    m_sequence.resize(Scenario::Cars().size(), 0);
+    m_calendarTime.clear();
+    m_calendarTime.resize(Scenario::Cars().size(), -1);
+    m_carsN.clear();
+    m_carsN.resize(crossesN, 0);
+    m_readyTime = -1;
+    for (unsigned int i = 0; i < cars.size(); ++i)
+    {
+        SimCar* car = cars[i];
+        if (car != 0 && car->GetIsInGarage())
+            Insert(car);
+    }
+}
+
+void GarageIndex::Insert(SimCar* car)
+{
+    int id = car->GetCar()->GetId();
+    ASSERT(car->GetIsInGarage());
+    ASSERT(m_readyKey[id] < 0 && m_calendarTime[id] < 0);
+    ++m_carsN[car->GetCar()->GetFromCrossId()];
+    File(car);
+}
+
+void GarageIndex::Remove(const SimCar* car)
+{
+    int id = car->GetCar()->GetId();
+    if (m_readyKey[id] < 0 && m_calendarTime[id] < 0)
+        return; //not indexed
+    Unfile(car);
+    --m_carsN[car->GetCar()->GetFromCrossId()];
+}
+
+void GarageIndex::Update(SimCar* car)
+{
+    int id = car->GetCar()->GetId();
+    if (m_readyKey[id] < 0 && m_calendarTime[id] < 0)
+        return; //not in garage
+    Unfile(car);
+    File(car);
+}
+
+void GarageIndex::File(SimCar* car)
+{
+    Entry entry = MakeEntry(car);
+    ASSERT(entry.RealTime >= 0);
+    if (entry.RealTime <= m_readyTime)
+    {
+        //cars of current time are appended in Advance, so this one is out of order
+        int index = GetListIndex(car);
+        entry.Sequence = ++m_sequence[entry.CarId];
+        m_late[index].push_back(entry);
+        m_isDirty[index] = true;
+        m_readyKey[entry.CarId] = entry.RealTime;
+    }
+    else
+    {
+        if ((int)m_calendar.size() <= entry.RealTime)
+            m_calendar.resize(entry.RealTime + 1);
+        m_calendar[entry.RealTime].push_back(entry);
+        m_calendarTime[entry.CarId] = entry.RealTime;
+    }
+}
+
+void GarageIndex::Unfile(const SimCar* car)
+{
+    int id = car->GetCar()->GetId();
+    if (m_readyKey[id] >= 0)
+    {
+        //the entry becomes stale, it is dropped in next clean up
+        ++m_sequence[id];
+        m_readyKey[id] = -1;
+        m_isDirty[GetListIndex(car)] = true;
+    }
+    m_calendarTime[id] = -1; //the entry in calendar becomes stale
+}
+
+void GarageIndex::Advance(const int& time)
+{
+    if (time < m_readyTime)
+    {
+        //time goes back, put cars not arrived back to calendar
+        std::vector<SimCar*> cars;
+        for (unsigned int i = 0; i < m_ready.size(); ++i)
+        {
+            CleanUp(i);
+            for (unsigned int j = 0; j < m_ready[i].size(); ++j)
+                if (m_ready[i][j].RealTime > time)
+                    cars.push_back(m_ready[i][j].Car);
+        }
+        m_readyTime = time;
+        for (unsigned int i = 0; i < cars.size(); ++i)
+        {
+            Unfile(cars[i]);
+            File(cars[i]);
+        }
+    }
+    for (int t = m_readyTime + 1; t <= time && t < (int)m_calendar.size(); ++t)
+    {
+        m_readyTime = t;
+        for (unsigned int i = 0; i < m_ready.size(); ++i)
+            m_arrivedIndex[i] = m_ready[i].size();
+        ReadyList& bucket = m_calendar[t];
+        for (unsigned int i = 0; i < bucket.size(); ++i)
+        {
+            Entry& entry = bucket[i];
+            if (m_calendarTime[entry.CarId] != t)
+                continue; //stale
+            m_calendarTime[entry.CarId] = -1;
+            entry.Sequence = ++m_sequence[entry.CarId];
+            m_ready[GetListIndex(entry.Car)].push_back(entry);
+            m_readyKey[entry.CarId] = t;
+        }
+        ReadyList().swap(bucket);
+        //cars of each time arrive after all ready ones, so only the arrived part need sorting
+        for (unsigned int i = 0; i < m_ready.size(); ++i)
+            if (m_arrivedIndex[i] + 1 < m_ready[i].size())
+                std::sort(m_ready[i].begin() + m_arrivedIndex[i], m_ready[i].end());
+    }
+    m_readyTime = std::max(m_readyTime, time);
+    for (unsigned int i = 0; i < m_ready.size(); ++i)
+        if (m_isDirty[i])
+            CleanUp(i);
+}
+
+void GarageIndex::CleanUp(const int& index)
+{
+    ReadyList& ready = m_ready[index];
+    unsigned int size = 0;
+    for (unsigned int i = 0; i < ready.size(); ++i)
+        if (IsValid(ready[i]))
+            ready[size++] = ready[i];
+    ready.resize(size);
+    ReadyList& late = m_late[index];
+    if (late.size() > 0)
+    {
+        std::sort(late.begin(), late.end());
+        for (unsigned int i = 0; i < late.size(); ++i)
+            if (IsValid(late[i]))
+                ready.push_back(late[i]);
+        std::inplace_merge(ready.begin(), ready.begin() + size, ready.end());
+        late.clear();
+    }
+    m_isDirty[index] = false;
+}
+
+bool CompareCarsInGarageOrder(SimCar* a, SimCar* b)
+{
+    return a->GetCar()->GetId() < b->GetCar()->GetId();
+}
+
+void GarageIndex::GetReadyCars(const int& crossId, std::vector<SimCar*>& cars) const
+{
+    cars.clear();
+    for (int vip = 0; vip < 2; ++vip)
+    {
+        const ReadyList& ready = m_ready[crossId * 2 + vip];
+        for (unsigned int i = 0; i < ready.size(); ++i)
+            cars.push_back(ready[i].Car);
+    }
+    std::sort(cars.begin(), cars.end(), &CompareCarsInGarageOrder);
+}
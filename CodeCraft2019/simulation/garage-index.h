@@ -0,0 +1,92 @@
+#ifndef GARAGE_INDEX_H
+#define GARAGE_INDEX_H
+
+#include <vector>
+
+class SimCar;
+
+/*
+ * cars waiting in garages, kept up to date by the owner scenario
+ *   cars whose real time is not arrived are kept in a calendar bucketed by real time
+ *   the others are kept in ready lists of each cross ordered by (real time, origin id),
+ *   so the work of each time is proportional to number of ready cars
+ */
+class GarageIndex
+{
+public:
+    struct Entry
+    {
+        int RealTime;
+        int OriginId;
+        SimCar* Car;
+        int CarId;
+        int Sequence; //entry is stale if the car is filed again
+        inline bool operator < (const Entry& o) const;
+    };
+    typedef std::vector<Entry> ReadyList;
+
+    GarageIndex();
+
+    void Build(const std::vector<SimCar*>& cars, const int& crossesN); //index all cars still in garage
+    void Insert(SimCar* car);
+    void Remove(const SimCar* car); //the car get out or is removed from scenario
+    void Update(SimCar* car); //real time of the car changed
+
+    /* move cars whose real time is arrived into ready lists, and clean up the lists */
+    void Advance(const int& time);
+    /* only valid until the next change of garage */
+    inline const ReadyList& GetReadyCars(const int& crossId, const bool& isVip) const;
+    void GetReadyCars(const int& crossId, std::vector<SimCar*>& cars) const; //VIP and non-VIP, in garage order
+    inline const int& GetCarsN(const int& crossId) const; //number of cars in garage, arrived or not
+
+private:
+    GarageIndex(const GarageIndex& o); //index holds cars of its owner, rebuild it instead of copying
+    GarageIndex& operator = (const GarageIndex& o);
+
+    void File(SimCar* car);
+    void Unfile(const SimCar* car);
+    inline int GetListIndex(const SimCar* car) const;
+    inline bool IsValid(const Entry& entry) const;
+    inline Entry MakeEntry(SimCar* car) const;
+    void CleanUp(const int& index);
+
+    std::vector<ReadyList> m_ready; //cross id * 2 + (VIP ? 1 : 0) -> cars in order
+    std::vector<ReadyList> m_late; //cars filed in ready lists out of order, waiting for merging
+    std::vector<bool> m_isDirty; //ready list has stale or late entries
+    std::vector<unsigned int> m_arrivedIndex; //ready list -> first entry arrived in current advancing
+    std::vector<ReadyList> m_calendar; //real time -> cars, entries moved away are left as stale
+    std::vector<int> m_readyKey; //car id -> real time used as key in ready list, [-1] means not ready
+    std::vector<int> m_sequence; //car id -> sequence of the valid entry in ready list
+    std::vector<int> m_calendarTime; //car id -> the bucket holding valid entry, [-1] means not in calendar
+    std::vector<int> m_carsN;
+    int m_readyTime; //cars with real time not greater than it are ready
+
+};//class GarageIndex
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline bool GarageIndex::Entry::operator < (const Entry& o) const
+{
+    if (RealTime != o.RealTime)
+        return RealTime < o.RealTime;
+    return OriginId < o.OriginId;
+}
+
+inline const GarageIndex::ReadyList& GarageIndex::GetReadyCars(const int& crossId, const bool& isVip) const
+{
+    return m_ready[crossId * 2 + (isVip ? 1 : 0)];
+}
+
+inline const int& GarageIndex::GetCarsN(const int& crossId) const
+{
+    return m_carsN[crossId];
+}
+
+#endif
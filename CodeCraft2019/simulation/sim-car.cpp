@@ -16,7 +16,7 @@ SimCar::SimCar()
 
 SimCar::SimCar(Car* car)
     : m_car(car), m_scenario(0), m_realTime(0), m_trace(&Tactics::Instance.GetTraces()[car->GetId()])
-    , m_isInGarage(true), m_isReachGoal(false), m_isLockOnNextRoad(false), m_lockOnNextRoadTime(-1), m_isIgnored(false), m_startTime(-1), m_canChangePath(false), m_canChangeRealTime(false), m_calculateTimeCache(-1), m_calculateTimeToken(-1)
+    , m_isInGarage(true), m_isReachGoal(false), m_isLockOnNextRoad(false), m_lockOnNextRoadTime(-1), m_isIgnored(false), m_startTime(-1), m_canChangePath(false), m_canChangeRealTime(false), m_spendTime(0), m_spendTimeVersion(0)
     , m_lastUpdateTime(-1), m_simState(SCHEDULED), m_waitingCar(0)
     , m_currentTraceIndex(0), m_currentRoad(0), m_currentLane(0), m_currentDirection(true), m_currentPosition(0)
 {
@@ -53,6 +53,17 @@ void SimCar::SetScenario(SimScenario* scenario)
     m_scenario = scenario;
 }
 
+void SimCar::SetRealTime(int realTime)
+{
+    ASSERT(!m_car->GetIsPreset() || m_canChangeRealTime);
+    ASSERT(realTime >= m_car->GetPlanTime());
+    if (*m_realTime == realTime)
+        return;
+    *m_realTime = realTime;
+    if (m_scenario != 0)
+        m_scenario->NotifyCarRealTimeChanged(this);
+}
+
 void SimCar::SetIsIgnored(const bool& ignored)
 {
     m_isIgnored = ignored;
@@ -148,6 +159,8 @@ void SimCar::UpdatePosition(int time, int position)
     SetSimState(time, SCHEDULED); //update state
     ASSERT(position > 0 && position <= m_currentRoad->GetLength());
     m_currentPosition = position;
+    if (m_scenario != 0)
+        m_scenario->Roads()[m_currentRoad->GetId()]->UpdatePosition(m_car, m_currentLane, !m_currentDirection, position);
 }
 
 void SimCar::UpdateWaiting(int time, SimCar* waitingCar)
@@ -207,36 +220,22 @@ std::pair<int, int> SimCar::CalculateLeaveTime(Road* current, Road* to, const in
     return std::make_pair(time, nextPosition);
 }
 
-int SimCar::CalculateSpendTime(bool useCache)
+int SimCar::CalculateSpendTime()
 {
-    if (!useCache || m_calculateTimeCache < 0)
+    if (m_spendTime == 0 || m_spendTimeVersion != m_trace->GetVersion())
     {
-        m_calculateTimeCache = 0;
-
+        m_spendTimeVersion = m_trace->GetVersion();
+        m_spendTime = 0;
         int pos = 0;
-        //ASSERT(m_trace->Size() > 0);
         for (uint iTrace = 0; iTrace < m_trace->Size(); ++iTrace)
         {
             Road* road = Scenario::Roads()[(*m_trace)[iTrace]];
             Road* nextRoad = iTrace == m_trace->Size() - 1 ? 0 : Scenario::Roads()[(*m_trace)[iTrace + 1]];
 
             auto next = CalculateLeaveTime(road, nextRoad, pos);
-            m_calculateTimeCache += next.first;
+            m_spendTime += next.first;
             pos = next.second;
         }
     }
-    if (m_calculateTimeCache <= 0)
-        m_calculateTimeCache = -1;
-    //ASSERT(m_calculateTimeCache > 0);
-    return m_calculateTimeCache;
-}
-
-int SimCar::CalculateSpendTime(const int& token)
-{
-    if (m_calculateTimeToken != token)
-    {
-        m_calculateTimeToken = token;
-        return CalculateSpendTime(false);
-    }
-    return m_calculateTimeCache;
+    return m_spendTime > 0 ? m_spendTime : -1;
 }
@@ -33,8 +33,8 @@ private:
     int m_startTime; //the time go on the first road
     bool m_canChangePath;
     bool m_canChangeRealTime;
-    int m_calculateTimeCache;
-    int m_calculateTimeToken;
+    int m_spendTime; //[0] means not calculated
+    unsigned int m_spendTimeVersion; //version of trace used for calculating above
     
     /* indicate update state of car in simulation */
     int m_lastUpdateTime;
@@ -67,7 +67,7 @@ public:
     void SetCanChangeRealTime(const bool& can);
 
     inline Car* GetCar() const;
-    inline void SetRealTime(int realTime);
+    void SetRealTime(int realTime); //notify the scenario for indexing garage
     inline int GetRealTime() const;
     inline Trace& GetTrace();
     inline const Trace& GetTrace() const;
@@ -109,8 +109,7 @@ public:
 
     //return delta time & position in next road
     std::pair<int, int> CalculateLeaveTime(Road* current, Road* to, const int& position) const;
-    int CalculateSpendTime(bool useCache);
-    int CalculateSpendTime(const int& token);
+    int CalculateSpendTime(); //cached until the trace changes, [-1] means empty trace
     
 };//class SimCar
 
@@ -128,13 +127,6 @@ inline Car* SimCar::GetCar() const
     return m_car;
 }
 
-inline void SimCar::SetRealTime(int realTime)
-{
-    ASSERT(!m_car->GetIsPreset() || m_canChangeRealTime);
-    ASSERT(realTime >= m_car->GetPlanTime());
-    *m_realTime = realTime;
-}
-
 inline int SimCar::GetRealTime() const
 {
     return *m_realTime;
@@ -16,6 +16,8 @@ SimRoad::SimRoad(Road* road)
     m_cars.resize(m_carSize);
     for (int i = 0; i < m_carSize; ++i)
         m_cars[i].reserve(m_road->GetLength());
+    m_tailPositions.resize(m_carSize, 0);
+    m_directionCarN[0] = m_directionCarN[1] = 0;
 }
 
 void SimRoad::Reset()
@@ -23,20 +25,34 @@ void SimRoad::Reset()
     for (int i = 0; i < m_carSize; ++i)
         m_cars[i].clear();
     m_carN = 0;
+    m_directionCarN[0] = m_directionCarN[1] = 0;
 }
 
-void SimRoad::RunIn(Car* car, const int& lane, const bool& opposite)
+void SimRoad::RunIn(Car* car, const int& lane, const bool& opposite, const int& position)
 {
-    GetCarsImpl(lane, opposite).push_back(car);
+    int index = GetLaneIndex(lane, opposite);
+    ASSERT(position > 0 && (m_cars[index].size() == 0 || position < m_tailPositions[index]));
+    m_cars[index].push_back(car);
+    m_tailPositions[index] = position;
     ++m_carN;
+    ++m_directionCarN[opposite ? 1 : 0];
 }
 
 Car* SimRoad::RunOut(const int& lane, const bool& opposite)
 {
-    auto& cars = GetCarsImpl(lane, opposite);
+    int index = GetLaneIndex(lane, opposite);
+    auto& cars = m_cars[index];
     ASSERT(cars.size() > 0);
     Car* ret = *cars.begin();
     cars.erase(cars.begin());
     --m_carN;
+    --m_directionCarN[opposite ? 1 : 0];
     return ret;
+}
+
+void SimRoad::UpdatePosition(Car* car, const int& lane, const bool& opposite, const int& position)
+{
+    int index = GetLaneIndex(lane, opposite);
+    if (m_cars[index].size() > 0 && m_cars[index].back() == car)
+        m_tailPositions[index] = position;
 }
\ No newline at end of file
@@ -13,13 +13,16 @@ private:
     Road* m_road;
     int m_carSize;
     int m_carN;
+    int m_directionCarN[2]; //[opposite] -> number of cars
     std::vector< std::vector<Car*> > m_cars; //lane -> car list
+    std::vector<int> m_tailPositions; //lane -> position of the last car, valid if the lane is not empty
 
     /* implements */
     inline const std::vector<Car*>& GetCarsImpl(const int& lane) const;
     inline const std::vector<Car*>& GetCarsOppositeImpl(const int& lane) const;
     inline const std::vector<Car*>& GetCarsImpl(const int& lane, bool opposite) const;
     inline std::vector<Car*>& GetCarsImpl(const int& lane, bool opposite);
+    inline int GetLaneIndex(const int& lane, bool opposite) const;
     
 public:
     SimRoad();
@@ -35,10 +38,16 @@ public:
     inline const std::vector<Car*>& GetCars(const int& lane, bool opposite) const; //opposite : [true] means end->start; [false] means start->end
     inline const std::vector<Car*>& GetCarsTo(const int& lane, const int& crossId) const;
     inline const std::vector<Car*>& GetCarsFrom(const int& lane, const int& crossId) const;
+    inline const int& GetCarN(bool opposite) const; //number of cars in all lanes of one direction
+    inline const int& GetCarNTo(const int& crossId) const;
+    inline const int& GetCarNFrom(const int& crossId) const;
+    inline int GetFreeTailSpace(const int& lane, bool opposite) const; //free length behind the last car
+    inline int GetOccupiedLength(const int& lane, bool opposite) const; //length from the last car to the end
 
     /* functions for running a car & changing the list */
-    void RunIn(Car* car, const int& lane, const bool& opposite);
+    void RunIn(Car* car, const int& lane, const bool& opposite, const int& position);
     Car* RunOut(const int& lane, const bool& opposite);
+    void UpdatePosition(Car* car, const int& lane, const bool& opposite, const int& position); //invoked when a car moves on this road
     
 };//class SimRoad
 
@@ -63,6 +72,13 @@ inline const int& SimRoad::GetCarN() const
     return m_carN;
 }
 
+inline int SimRoad::GetLaneIndex(const int& lane, bool opposite) const
+{
+    ASSERT(lane > 0 && lane <= m_road->GetLanes());
+    ASSERT((opposite ? m_road->GetLanes() + lane : lane) <= m_carSize);
+    return opposite ? m_road->GetLanes() + lane - 1 : lane - 1;
+}
+
 inline const std::vector<Car*>& SimRoad::GetCarsImpl(const int& lane) const
 {
     ASSERT(lane > 0 && lane <= m_road->GetLanes());
@@ -120,5 +136,31 @@ inline const std::vector<Car*>& SimRoad::GetCarsFrom(const int& lane, const int&
     return GetCars(lane, !m_road->IsFromOrTo(crossId));
 }
 
+inline const int& SimRoad::GetCarN(bool opposite) const
+{
+    return m_directionCarN[opposite ? 1 : 0];
+}
+
+inline const int& SimRoad::GetCarNTo(const int& crossId) const
+{
+    return GetCarN(m_road->IsFromOrTo(crossId));
+}
+
+inline const int& SimRoad::GetCarNFrom(const int& crossId) const
+{
+    return GetCarN(!m_road->IsFromOrTo(crossId));
+}
+
+inline int SimRoad::GetFreeTailSpace(const int& lane, bool opposite) const
+{
+    int index = GetLaneIndex(lane, opposite);
+    return m_cars[index].size() > 0 ? m_tailPositions[index] - 1 : m_road->GetLength();
+}
+
+inline int SimRoad::GetOccupiedLength(const int& lane, bool opposite) const
+{
+    return m_road->GetLength() - GetFreeTailSpace(lane, opposite);
+}
+
 
 #endif
@@ -1,7 +1,7 @@
 #include "sim-scenario.h"
 #include "assert.h"
 #include "config.h"
-#include <fstream>
+#include "buffered-writer.h"
 
 SimScenario::SimScenario(bool onlyPreset)
     : m_reachCarsN(0), m_carOnRoadN(0), m_carInGarageN(0)
@@ -10,8 +10,9 @@ SimScenario::SimScenario(bool onlyPreset)
     m_simGarages.resize(Scenario::Crosses().size());
     for (uint i = 0; i < m_simGarages.size(); ++i)
     {
-        m_simGarages[i].resize(Scenario::GetGarageSize(i), 0);
+        m_simGarages[i].reserve(Scenario::GetGarageSize(i));
     }
+    m_garagePositions.resize(Scenario::Cars().size(), -1);
     m_simRoads.resize(Scenario::Roads().size(), 0);
     m_simCars.resize(Scenario::Cars().size(), 0);
     for (uint i = 0; i < m_simCars.size(); ++i)
@@ -22,7 +23,7 @@ SimScenario::SimScenario(bool onlyPreset)
             SimCar* simCar = new SimCar(car);
             simCar->SetScenario(this);
             m_simCars[i] = simCar;
-            m_simGarages[simCar->GetCar()->GetFromCrossId()][Scenario::GetGarageInnerIndex(i)] = simCar;
+            PushToGarage(simCar);
             ++m_carInGarageN;
         }
     }
@@ -30,6 +31,7 @@ SimScenario::SimScenario(bool onlyPreset)
     {
         m_simRoads[i] = new SimRoad(Scenario::Roads()[i]);
     }
+    RebuildGarageIndex();
 }
 
 void SimScenario::Clear()
@@ -65,15 +67,19 @@ SimScenario& SimScenario::operator = (const SimScenario& o)
     m_simCars.resize(o.m_simCars.size(), 0);
     for (uint i = 0; i < m_simGarages.size(); ++i)
     {
-        m_simGarages[i].resize(Scenario::GetGarageSize(i), 0);
+        m_simGarages[i].clear();
+        m_simGarages[i].reserve(o.m_simGarages[i].size());
     }
+    m_garagePositions.clear();
+    m_garagePositions.resize(o.m_garagePositions.size(), -1);
     for (uint i = 0; i < m_simCars.size(); ++i)
     {
         if (o.m_simCars[i] != 0)
         {
             m_simCars[i] = new SimCar(*o.m_simCars[i]);
             m_simCars[i]->SetScenario(this);
-            m_simGarages[m_simCars[i]->GetCar()->GetFromCrossId()][Scenario::GetGarageInnerIndex(i)] = m_simCars[i];
+            if (m_simCars[i]->GetIsInGarage())
+                PushToGarage(m_simCars[i]);
         }
     }
     for (uint i = 0; i < m_simRoads.size(); ++i)
@@ -91,6 +97,7 @@ SimScenario& SimScenario::operator = (const SimScenario& o)
     m_vipFirstPlanTime = o.m_vipFirstPlanTime;
     m_vipLastReachTime = o.m_vipLastReachTime;
     m_vipTotalCompleteTime = o.m_vipTotalCompleteTime;
+    RebuildGarageIndex();
     return *this;
 }
 
@@ -119,6 +126,8 @@ void SimScenario::NotifyCarGetoutOnRoad(const int& time, const SimCar* car)
     ASSERT(m_carInGarageN > 0);
     --m_carInGarageN;
     ++m_carOnRoadN;
+    PopFromGarage(car);
+    m_garageIndex.Remove(car);
 }
 
 void SimScenario::NotifyCarReachGoal(const int& time, const SimCar* car)
@@ -138,6 +147,39 @@ void SimScenario::NotifyCarReachGoal(const int& time, const SimCar* car)
     m_totalCompleteTime += cost;
 }
 
+void SimScenario::NotifyCarRealTimeChanged(SimCar* car)
+{
+    m_garageIndex.Update(car);
+}
+
+void SimScenario::RebuildGarageIndex()
+{
+    m_garageIndex.Build(m_simCars, Scenario::Crosses().size());
+}
+
+void SimScenario::PushToGarage(SimCar* car)
+{
+    int& position = m_garagePositions[car->GetCar()->GetId()];
+    ASSERT(position < 0);
+    std::vector<SimCar*>& garage = m_simGarages[car->GetCar()->GetFromCrossId()];
+    position = garage.size();
+    garage.push_back(car);
+}
+
+void SimScenario::PopFromGarage(const SimCar* car)
+{
+    int& position = m_garagePositions[car->GetCar()->GetId()];
+    if (position < 0)
+        return;
+    std::vector<SimCar*>& garage = m_simGarages[car->GetCar()->GetFromCrossId()];
+    ASSERT(position < (int)garage.size() && garage[position] == car);
+    SimCar* last = garage.back();
+    garage[position] = last;
+    m_garagePositions[last->GetCar()->GetId()] = position;
+    garage.pop_back();
+    position = -1;
+}
+
 void SimScenario::SaveToFile() const
 {
     SaveToFile(Config::PathResult.c_str());
@@ -145,24 +187,23 @@ void SimScenario::SaveToFile() const
 
 void SimScenario::SaveToFile(const char* file) const
 {
-    std::ofstream ofs(file);
-    ASSERT(ofs.is_open());
+    BufferedWriter writer(m_simCars.size() * 64);
     for (uint i = 0; i < m_simCars.size(); ++i)
     {
         const SimCar* car = m_simCars[i];
         if (!car->GetCar()->GetIsPreset() || car->GetCanChangePath() || car->GetCanChangeRealTime())
         {
-            ofs << '(' << car->GetCar()->GetOriginId() << ", " << car->GetRealTime();
+            writer.Write('(').Write(car->GetCar()->GetOriginId()).Write(", ").Write(car->GetRealTime());
             ASSERT(car->GetTrace().Head() != car->GetTrace().Tail());
             for (uint i = 0; i < car->GetTrace().Size(); ++i)
             {
-                ofs << ", " << Scenario::Roads()[car->GetTrace()[i]]->GetOriginId();
+                writer.Write(", ").Write(Scenario::Roads()[car->GetTrace()[i]]->GetOriginId());
             }
-            ofs << ")\n";
+            writer.Write(")\n");
         }
     }
-    ofs.flush();
-    ofs.close();
+    bool result = writer.Commit(file);
+    ASSERT_MSG(result, "can not write " << file);
 }
 
 bool SimScenario::IsComplete() const
@@ -175,23 +216,23 @@ SimCar* SimScenario::AddCar(Car* car)
     ASSERT(m_reachCarsN == 0 && m_carOnRoadN == 0);
     ASSERT(m_simCars[car->GetId()] == 0);
     SimCar* simCar = new SimCar(car);
+    simCar->SetScenario(this);
     m_simCars[car->GetId()] = simCar;
-    SimCar*& carInGarage = m_simGarages[car->GetFromCrossId()][Scenario::GetGarageInnerIndex(car->GetId())];
-    ASSERT(carInGarage == 0);
-    carInGarage = simCar;
+    PushToGarage(simCar);
+    m_garageIndex.Insert(simCar);
     return simCar;
 }
 
 void SimScenario::RemoveCar(SimCar* car)
 {
     ASSERT(m_reachCarsN == 0 && m_carOnRoadN == 0);
-    SimCar*& carInGarage = m_simGarages[car->GetCar()->GetFromCrossId()][Scenario::GetGarageInnerIndex(car->GetCar()->GetId())];
     SimCar*& carInVector = m_simCars[car->GetCar()->GetId()];
-    ASSERT(carInGarage != 0);
     ASSERT(carInVector != 0);
-    ASSERT(carInGarage == carInVector);
-    delete carInGarage;
-    carInGarage = 0;
+    ASSERT(carInVector == car);
+    ASSERT(m_garagePositions[car->GetCar()->GetId()] >= 0);
+    PopFromGarage(car);
+    m_garageIndex.Remove(car);
+    delete car;
     carInVector = 0;
 }
 
@@ -209,6 +250,7 @@ void SimScenario::ResetScenario()
     {
         m_simGarages[i].clear();
     }
+    m_garagePositions.assign(m_garagePositions.size(), -1);
     m_carInGarageN = 0;
     for (uint i = 0; i < m_simCars.size(); ++i)
     {
@@ -216,7 +258,7 @@ void SimScenario::ResetScenario()
         if (car != 0)
         {
             car->Reset();
-            m_simGarages[car->GetCar()->GetFromCrossId()].push_back(car);
+            PushToGarage(car);
             ++m_carInGarageN;
         }
     }
@@ -231,4 +273,5 @@ void SimScenario::ResetScenario()
     m_vipFirstPlanTime = -1;
     m_vipLastReachTime = -1;
     m_vipTotalCompleteTime = 0;
+    RebuildGarageIndex();
 }
\ No newline at end of file
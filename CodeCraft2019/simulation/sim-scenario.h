@@ -3,6 +3,7 @@
 
 #include "sim-car.h"
 #include "sim-road.h"
+#include "garage-index.h"
 #include <map>
 #include <vector>
 #include "scenario.h"
@@ -10,9 +11,11 @@
 class SimScenario
 {
 protected:
-    std::vector< std::vector<SimCar*> > m_simGarages; //indexed by cross id
+    std::vector< std::vector<SimCar*> > m_simGarages; //indexed by cross id, only cars still in garage, sort by car id for order of garage
+    std::vector<int> m_garagePositions; //car id -> position in its garage, [-1] means not in garage
     std::vector<SimRoad*> m_simRoads;
     std::vector<SimCar*> m_simCars;
+    GarageIndex m_garageIndex;
     unsigned int m_reachCarsN;
     unsigned int m_carOnRoadN;
     unsigned int m_carInGarageN;
@@ -40,9 +43,11 @@ public:
     inline const unsigned int& GetCarInGarageN() const;
     inline const unsigned int& GetReachCarsN() const;
     inline int GetOnRoadCarsN() const;
+    inline GarageIndex& GetGarageIndex();
 
     void NotifyCarGetoutOnRoad(const int& time, const SimCar* car);
     void NotifyCarReachGoal(const int& time, const SimCar* car);
+    void NotifyCarRealTimeChanged(SimCar* car);
     bool IsComplete() const;
     
     SimCar* AddCar(Car* car);
@@ -53,6 +58,11 @@ public:
     void SaveToFile() const;
     void SaveToFile(const char* file) const;
 
+protected:
+    void RebuildGarageIndex();
+    void PushToGarage(SimCar* car);
+    void PopFromGarage(const SimCar* car); //swap with the last one, keep garage compact
+
 private:
     void Clear();
 
@@ -97,4 +107,9 @@ inline int SimScenario::GetOnRoadCarsN() const
     return m_carOnRoadN;
 }
 
+inline GarageIndex& SimScenario::GetGarageIndex()
+{
+    return m_garageIndex;
+}
+
 #endif
@@ -2,10 +2,17 @@
 #include "scheduler.h"
 #include "assert.h"
 #include "log.h"
+#include "profiler.h"
 #include <algorithm>
+#include <chrono>
 
 Simulator Simulator::Instance;
 
+Simulator::UpdateResult::UpdateResult()
+    : Conflict(false), CyclesN(0), CrossVisitsN(0), PassCrossCallsN(0), PassCrossProgressN(0)
+    , Phase1MovedCarsN(0), GarageReleasedN(0), FirstPriorityReroutesN(0), SpendMicroseconds(0)
+{ }
+
 Simulator::Simulator()
     : m_scheduler(0), m_scheduledCarsN(0), m_reachedCarsN(0), m_conflictFlag(false)
     , m_isEnableCheater(true)
@@ -28,7 +35,7 @@ void Simulator::HandleUpdateState(const SimCar::SimState& state)
         ++m_scheduledCarsN;
 }
 
-void Simulator::NotifyFirstPriority(const int& time, SimScenario& scenario, SimCar* car) const
+void Simulator::NotifyFirstPriority(const int& time, SimScenario& scenario, SimCar* car, UpdateResult& result) const
 {
     if (!car->GetIsLockOnNextRoad())
     {
@@ -38,6 +45,7 @@ void Simulator::NotifyFirstPriority(const int& time, SimScenario& scenario, SimC
         if (m_scheduler != 0)
             m_scheduler->HandleBecomeFirstPriority(time, scenario, car);
         car->LockOnNextRoad(time);
+        ++result.FirstPriorityReroutesN;
     }
 }
 
@@ -62,7 +70,7 @@ bool Simulator::GetIsCompleted(SimScenario& scenario) const
     return (m_scheduledCarsN - m_reachedCarsN) == scenario.GetOnRoadCarsN();
 }
 
-int Simulator::GetPositionInNextRoad(const int& time, SimScenario& scenario, SimCar* car) const
+int Simulator::GetPositionInNextRoad(const int& time, SimScenario& scenario, SimCar* car, UpdateResult& result) const
 {
     int currentLimit = std::min(car->GetCurrentRoad()->GetLimit(), car->GetCar()->GetMaxSpeed());
     int s1 = std::min(currentLimit, car->GetCurrentRoad()->GetLength() - car->GetCurrentPosition());
@@ -71,7 +79,7 @@ int Simulator::GetPositionInNextRoad(const int& time, SimScenario& scenario, Sim
     int maxS2 = car->GetCar()->GetMaxSpeed() - s1;
     if (car->GetCurrentCross()->GetId() == car->GetCar()->GetToCrossId() && car->GetNextRoadId() < 0) //reach goal
         return maxS2;
-    NotifyFirstPriority(time, scenario, car);
+    NotifyFirstPriority(time, scenario, car, result);
     ASSERT(car->GetNextRoadId() >= 0);
     int nextLimit = std::min(car->GetCar()->GetMaxSpeed(), Scenario::Roads()[car->GetNextRoadId()]->GetLimit());
     int s2 = std::min(maxS2, nextLimit - s1);
@@ -81,7 +89,7 @@ int Simulator::GetPositionInNextRoad(const int& time, SimScenario& scenario, Sim
 }
 
 //car on first priority
-SimCar* Simulator::PeekFirstPriorityCarOnRoad(const int& time, SimScenario& scenario, const SimRoad* road, const int& crossId) const
+SimCar* Simulator::PeekFirstPriorityCarOnRoad(const int& time, SimScenario& scenario, const SimRoad* road, const int& crossId, UpdateResult& result) const
 {
     SimCar* ret = 0;
     int position = road->GetRoad()->GetLength() + 1;
@@ -113,7 +121,7 @@ SimCar* Simulator::PeekFirstPriorityCarOnRoad(const int& time, SimScenario& scen
     }
     if (ret != 0)
     {
-        GetPositionInNextRoad(time, scenario, ret);//for notify first priority if needed
+        GetPositionInNextRoad(time, scenario, ret, result);//for notify first priority if needed
         ASSERT(ret->GetNextRoadId() >= 0 || ret->GetCurrentCross() == ret->GetCar()->GetToCross());
     }
     return ret;
@@ -133,14 +141,14 @@ bool CompareCarsPriority(SimCar* a, SimCar* b)
 }
 
 //pass cross or just forward, return [true] means scheduled; [false] means waiting, require the car is the first one on its lane
-bool Simulator::PassCrossOrJustForward(const int& time, SimScenario& scenario, SimCar* car)
+bool Simulator::PassCrossOrJustForward(const int& time, SimScenario& scenario, SimCar* car, UpdateResult& result)
 {
     SimRoad* road = scenario.Roads()[car->GetCurrentRoad()->GetId()];
     ///logic moved
     Cross* cross = car->GetCurrentCross();
     auto& carlist = road->GetCarsTo(car->GetCurrentLane(), cross->GetId());
     ASSERT(car->GetCar() == *carlist.begin());
-    int s2 = GetPositionInNextRoad(time, scenario, car);
+    int s2 = GetPositionInNextRoad(time, scenario, car, result);
     int nextRoadId = car->GetNextRoadId();
     bool reachGoal = nextRoadId < 0;
     if (reachGoal)
@@ -188,7 +196,7 @@ bool Simulator::PassCrossOrJustForward(const int& time, SimScenario& scenario, S
 
     SimRoad* nextRoad = scenario.Roads()[nextRoadId];
     bool isFromOrTo = nextRoad->GetRoad()->IsFromOrTo(cross->GetId());
-    int nextPosition = GetPositionInNextRoad(time, scenario, car);
+    int nextPosition = GetPositionInNextRoad(time, scenario, car, result);
     if (nextPosition <= 0) //just forward
     {
         //ASSERT(false);//the car which can not pass the cross should forward in another function
@@ -218,8 +226,8 @@ bool Simulator::PassCrossOrJustForward(const int& time, SimScenario& scenario, S
         if (lastcar == 0 || lastcar->GetCurrentPosition() != 1)
         {
             //go on the new road & remove from old road
-            nextRoad->RunIn(road->RunOut(car->GetCurrentLane(), !car->GetCurrentDirection()), i, !isFromOrTo);
             int newPosition = lastcar == 0 ? nextPosition : std::min(lastcar->GetCurrentPosition() - 1, nextPosition);
+            nextRoad->RunIn(road->RunOut(car->GetCurrentLane(), !car->GetCurrentDirection()), i, !isFromOrTo, newPosition);
             car->UpdateOnRoad(time, nextRoad->GetRoad(), i, isFromOrTo, newPosition);
             updatedState = true;
             //break;
@@ -235,10 +243,11 @@ bool Simulator::PassCrossOrJustForward(const int& time, SimScenario& scenario, S
     return false;
 }
 
-void UpdateCarsInLane(const int& time, SimScenario& scenario, SimRoad* &road, const int& lane, const bool& opposite, const bool& canBreak)
+int Simulator::UpdateCarsInLane(const int& time, SimScenario& scenario, SimRoad* &road, const int& lane, const bool& opposite, const bool& canBreak)
 {
     auto& cars = road->GetCars(lane, opposite);
     SimCar* frontCar = 0;
+    int movedN = 0;
     for (uint i = 0; i < cars.size(); ++i)
     {
         SimCar* car = scenario.Cars()[cars[i]->GetId()];
@@ -256,6 +265,7 @@ void UpdateCarsInLane(const int& time, SimScenario& scenario, SimRoad* &road, co
                 //if (Simulator::GetPositionInNextRoad(time, scenario, car) <= 0) //will not pass cross
                 {
                     car->UpdatePosition(time, std::min(nexPosition, road->GetRoad()->GetLength()));
+                    ++movedN;
                 }
                 else //may pass cross
                 {
@@ -276,23 +286,27 @@ void UpdateCarsInLane(const int& time, SimScenario& scenario, SimRoad* &road, co
                 else
                 {
                     car->UpdatePosition(time, std::min(nexPosition, frontPosition - 1));
+                    ++movedN;
                 }
             }
         }
         frontCar = car;
     }
+    return movedN;
 }
 
-void UpdateCarsInRoad(const int& time, SimScenario& scenario, SimRoad* road)
+int Simulator::UpdateCarsInRoad(const int& time, SimScenario& scenario, SimRoad* road)
 {
     int lanes = road->GetRoad()->GetLanes();
+    int movedN = 0;
     for (int i = 0; i < lanes * 2; ++i)
     {
         bool opposite = i >= lanes;
         if (opposite && !road->GetRoad()->GetIsTwoWay())
             break;
-        UpdateCarsInLane(time, scenario, road, (i % lanes) + 1, opposite, false);
+        movedN += UpdateCarsInLane(time, scenario, road, (i % lanes) + 1, opposite, false);
     }
+    return movedN;
 }
 
 bool CompareRoadId(SimRoad* a, SimRoad* b)
@@ -302,27 +316,33 @@ bool CompareRoadId(SimRoad* a, SimRoad* b)
 
 Simulator::UpdateResult Simulator::Update(const int& time, SimScenario& scenario)
 {
+    PROFILE_ZONE("simulator.update");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     SimCar::SetUpdateStateNotifier(Callback::Create(&Simulator::HandleUpdateState, this));
     Simulator::UpdateResult result;
-    result.Conflict = false;
 
     NotifyScheduleStart();
+    PROFILE_SCOPE(lanesScope, "simulator.lanes");
     m_firstPriorities.resize(scenario.Roads().size());
     for (uint i = 0; i < scenario.Roads().size(); ++i)
     {
         SimRoad* road = scenario.Roads()[i];
-        UpdateCarsInRoad(time, scenario, road);
-        m_firstPriorities[i].first = PeekFirstPriorityCarOnRoad(time, scenario, road, road->GetRoad()->GetEndCrossId());
-        m_firstPriorities[i].second = road->GetRoad()->GetIsTwoWay() ? PeekFirstPriorityCarOnRoad(time, scenario, road, road->GetRoad()->GetStartCrossId()) : 0;
+        result.Phase1MovedCarsN += UpdateCarsInRoad(time, scenario, road);
+        m_firstPriorities[i].first = PeekFirstPriorityCarOnRoad(time, scenario, road, road->GetRoad()->GetEndCrossId(), result);
+        m_firstPriorities[i].second = road->GetRoad()->GetIsTwoWay() ? PeekFirstPriorityCarOnRoad(time, scenario, road, road->GetRoad()->GetStartCrossId(), result) : 0;
     }
+    lanesScope.Stop();
     InitializeCarsInGarage(time, scenario);
-    GetVipOutFromGarage(time, scenario);
+    result.GarageReleasedN += GetVipOutFromGarage(time, scenario);
+    PROFILE_SCOPE(crossesScope, "simulator.crosses");
     while(true)
     {
         NotifyScheduleCycleStart();
+        ++result.CyclesN;
         for (uint iCross = 0; iCross < Scenario::Crosses().size(); ++iCross)
         {
             Cross* cross = Scenario::Crosses()[iCross];
+            ++result.CrossVisitsN;
             int crossId = cross->GetId();
             static std::vector<SimRoad*> roads; //roads in this cross
             roads.clear();
@@ -350,17 +370,19 @@ Simulator::UpdateResult Simulator::Update(const int& time, SimScenario& scenario
                     int oldRoadId = firstPriority->GetCurrentRoad()->GetId();
                     int lane = firstPriority->GetCurrentLane();
                     bool opposite = !firstPriority->GetCurrentDirection();
-                    if (!Simulator::PassCrossOrJustForward(time, scenario, firstPriority))
+                    ++result.PassCrossCallsN;
+                    if (!Simulator::PassCrossOrJustForward(time, scenario, firstPriority, result))
                     {
                         ASSERT (firstPriority->GetSimState(time) == SimCar::WAITING && firstPriority->GetWaitingCar(time) != 0);
                         break;
                     }
+                    ++result.PassCrossProgressN;
                     //UpdateCarsInRoad(time, scenario, road);
                     UpdateCarsInLane(time, scenario, road, lane, opposite, true);
                     (road->GetRoad()->IsFromOrTo(crossId) ? m_firstPriorities[road->GetRoad()->GetId()].second : m_firstPriorities[road->GetRoad()->GetId()].first)
-                        = PeekFirstPriorityCarOnRoad(time, scenario, road, cross->GetId());
+                        = PeekFirstPriorityCarOnRoad(time, scenario, road, cross->GetId(), result);
                     //GetVipOutFromGarage(time, scenario);
-                    GetVipOutFromGarage(time, scenario, road->GetRoad()->GetPeerCross(cross)->GetId(), road->GetRoad()->GetId());
+                    result.GarageReleasedN += GetVipOutFromGarage(time, scenario, road->GetRoad()->GetPeerCross(cross)->GetId(), road->GetRoad()->GetId());
                     //GetVipOutFromGarage(time, scenario, crossId, firstPriority->GetCurrentRoad()->GetId());
                     //crossConflict = false;
                 }
@@ -368,7 +390,6 @@ Simulator::UpdateResult Simulator::Update(const int& time, SimScenario& scenario
         }
         if (GetIsCompleted(scenario)) //complete
         {
-            result.Conflict = false;
             break;
         }
         if (GetIsDeadLock(scenario)) //conflict
@@ -378,15 +399,18 @@ Simulator::UpdateResult Simulator::Update(const int& time, SimScenario& scenario
             break;
         }
     }
+    crossesScope.Stop();
     if (!result.Conflict)
     {
+        PROFILE_ZONE("simulator.garage");
         if (m_scheduler != 0)
             m_scheduler->HandleBeforeGarageDispatch(time, scenario);
-        GetVipOutFromGarage(time, scenario);
-        GetOutFromGarage(time, scenario);
+        result.GarageReleasedN += GetVipOutFromGarage(time, scenario);
+        result.GarageReleasedN += GetOutFromGarage(time, scenario);
     }
     //ASSERT(result.Conflict || scheduledCarsN - reachedCarsN == scenario.GetOnRoadCarsN());
     LOG("@ " << time << " Cars in garage : "<< scenario.GetCarInGarageN() << ", Cars on road : " << scenario.GetOnRoadCarsN() << ", Cars reached goal : " << scenario.GetReachCarsN());
+    result.SpendMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
     return result;
 }
 
@@ -430,29 +454,15 @@ bool Simulator::GetCarOutFromGarage(const int& time, SimScenario& scenario, SimC
         SimRoad* road = scenario.Roads()[roadId];
         bool isFromOrTo = road->GetRoad()->IsFromOrTo(car->GetCar()->GetFromCrossId());
         car->UpdateOnRoad(time, road->GetRoad(), canGoout.first, isFromOrTo, canGoout.second);
-        road->RunIn(car->GetCar(), canGoout.first, !isFromOrTo);
+        road->RunIn(car->GetCar(), canGoout.first, !isFromOrTo, canGoout.second);
     }
     if (canGoout.first >= 0 && canGoout.second >= 0 && (!car->GetCar()->GetIsPreset() || car->GetCanChangeRealTime()) && m_isEnableCheater)
         car->SetRealTime(time + (goout ? 0 : 1));
     return goout;
 }
 
-struct CompareCarsInGarageStruct
-{
-    bool operator() (SimCar* a, SimCar* b)
-    {
-        //only compare VIP or non-VIP cars
-        if (a == 0 || b == 0)
-            return a != 0;
-        ASSERT(a->GetCar()->GetIsVip() == b->GetCar()->GetIsVip());
-        if (a->GetRealTime() != b->GetRealTime())
-            return a->GetRealTime() < b->GetRealTime();
-        return a->GetCar()->GetOriginId() < b->GetCar()->GetOriginId();
-    }
-} CompareCarsInGarage;
-
 /* non-VIP cars */
-void Simulator::GetOutFromGarage(const int& time, SimScenario& scenario) const
+int Simulator::GetOutFromGarage(const int& time, SimScenario& scenario) const
 {
     int getOutCounter = 0;
     for (uint i = 0; i < scenario.Garages().size(); ++i)
@@ -487,6 +497,7 @@ void Simulator::GetOutFromGarage(const int& time, SimScenario& scenario) const
     }
     if (getOutCounter > 0)
         LOG("@" << time << " number of non-VIP cars get on road form garage : " << getOutCounter);
+    return getOutCounter;
 }
 
 void Simulator::InitializeCarsInGarage(const int& time, SimScenario& scenario)
@@ -497,29 +508,25 @@ void Simulator::InitializeCarsInGarage(const int& time, SimScenario& scenario)
         m_carsInGarage.resize(scenario.Garages().size());
         m_vipCarsInGarage.resize(scenario.Garages().size());
     }
+    GarageIndex& garageIndex = scenario.GetGarageIndex();
+    garageIndex.Advance(time);
     for (uint i = 0; i < scenario.Garages().size(); ++i)
     {
         m_carsInGarage[i].clear();
         m_vipCarsInGarage[i].clear();
-    }
-    for (uint i = 0; i < scenario.Cars().size(); ++i)
-    {
-        SimCar* car = scenario.Cars()[i];
-        if (car == 0 || !car->GetIsInGarage() || car->GetRealTime() > time) continue;
-        if (car->GetCar()->GetIsVip())
-            m_vipCarsInGarage[car->GetCar()->GetFromCrossId()].push_back(car);
-        else
-            m_carsInGarage[car->GetCar()->GetFromCrossId()].push_back(car);
-    }
-    for (uint i = 0; i < scenario.Garages().size(); ++i)
-    {
-        std::sort(m_carsInGarage[i].begin(), m_carsInGarage[i].end(), CompareCarsInGarage);
-        std::sort(m_vipCarsInGarage[i].begin(), m_vipCarsInGarage[i].end(), CompareCarsInGarage);
+        //ready lists are already in order of (real time, origin id)
+        const GarageIndex::ReadyList& cars = garageIndex.GetReadyCars(i, false);
+        for (uint iCar = 0; iCar < cars.size(); ++iCar)
+            m_carsInGarage[i].push_back(cars[iCar].Car);
+        const GarageIndex::ReadyList& vipCars = garageIndex.GetReadyCars(i, true);
+        for (uint iCar = 0; iCar < vipCars.size(); ++iCar)
+            m_vipCarsInGarage[i].push_back(vipCars[iCar].Car);
     }
 }
 
-void Simulator::GetVipOutFromGarage(const int& time, SimScenario& scenario, const int& crossId, const int& roadId)
+int Simulator::GetVipOutFromGarage(const int& time, SimScenario& scenario, const int& crossId, const int& roadId)
 {
+    int getOutCounter = 0;
     if (crossId >= 0)
     {
         auto& garage = m_vipCarsInGarage[crossId];
@@ -545,6 +552,10 @@ void Simulator::GetVipOutFromGarage(const int& time, SimScenario& scenario, cons
                             car->LockOnNextRoad(time);
                         car->UpdateStayInGarage(time);
                     }
+                    else
+                    {
+                        ++getOutCounter;
+                    }
                 }
             }
         }
@@ -553,14 +564,16 @@ void Simulator::GetVipOutFromGarage(const int& time, SimScenario& scenario, cons
     {
         ASSERT(roadId < 0);
         for (uint i = 0; i < m_vipCarsInGarage.size(); ++i)
-            GetVipOutFromGarage(time, scenario, i, roadId);
+            getOutCounter += GetVipOutFromGarage(time, scenario, i, roadId);
     }
+    return getOutCounter;
 }
 
 std::list<SimCar*> Simulator::GetDeadLockCars(const int& time, SimScenario& scenario) const
 {
     //find all waiting first priority cars
     std::list<SimCar*> allFirstPriorityCars;
+    UpdateResult ignored; //counters out of a tick
     for (uint iCross = 0; iCross < Scenario::Crosses().size(); ++iCross)
     {
         Cross* cross = Scenario::Crosses()[iCross];
@@ -573,7 +586,7 @@ std::list<SimCar*> Simulator::GetDeadLockCars(const int& time, SimScenario& scen
                 SimRoad* road = scenario.Roads()[id];
                 if (road->GetRoad()->CanReachTo(crossId))
                 {
-                    SimCar* firstPriority = PeekFirstPriorityCarOnRoad(time, scenario, road, crossId);
+                    SimCar* firstPriority = PeekFirstPriorityCarOnRoad(time, scenario, road, crossId, ignored);
                     if (firstPriority != 0 && firstPriority->GetSimState(time) != SimCar::SCHEDULED)
                     {
                         ASSERT(firstPriority->GetSimState(time) == SimCar::WAITING);
@@ -635,6 +648,7 @@ std::list<SimCar*> Simulator::GetDeadLockCars(const int& time, SimScenario& scen
 void Simulator::PrintCrossState(const int& time, SimScenario& scenario, Cross* cross) const
 {
     int crossId = cross->GetId();
+    UpdateResult ignored; //counters out of a tick
     for (int i = (int)Cross::NORTH; i <= (int)Cross::WEST; ++i)
     {
         int id = cross->GetRoadId((Cross::DirectionType)i);
@@ -651,7 +665,7 @@ void Simulator::PrintCrossState(const int& time, SimScenario& scenario, Cross* c
                     for (auto carIte = cars.begin(); carIte != cars.end(); ++carIte)
                     {
                         SimCar* car = scenario.Cars()[(*carIte)->GetId()];
-                        if (car->GetSimState(time) == SimCar::SCHEDULED || GetPositionInNextRoad(time, scenario, car) <= 0)
+                        if (car->GetSimState(time) == SimCar::SCHEDULED || GetPositionInNextRoad(time, scenario, car, ignored) <= 0)
                             break;
                         LOG(" \t\t" << *(car->GetCar())
                             << " pos " << car->GetCurrentPosition()
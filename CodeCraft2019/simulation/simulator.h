@@ -9,9 +9,19 @@ class Scheduler;
 class Simulator
 {  
 public:
+    /* result & counters of one tick, counters are summed over the tick (see TickMetricsWriter) */
     struct UpdateResult
     {
+        UpdateResult();
         bool Conflict;
+        int CyclesN; //schedule cycles to resolve waiting cars
+        int CrossVisitsN;
+        int PassCrossCallsN;
+        int PassCrossProgressN; //calls which scheduled the car
+        int Phase1MovedCarsN; //cars moved on their lanes before crosses are scheduled
+        int GarageReleasedN;
+        int FirstPriorityReroutesN; //cars becoming first priority, the scheduler may change their paths
+        int SpendMicroseconds;
 
     };//struct UpdateResult
 
@@ -31,7 +41,7 @@ private:
     void HandleUpdateState(const SimCar::SimState& state);
 
     /* for notify scheduler */
-    void NotifyFirstPriority(const int& time, SimScenario& scenario, SimCar* car) const;
+    void NotifyFirstPriority(const int& time, SimScenario& scenario, SimCar* car, UpdateResult& result) const;
 
     /* for notify simulator itself */
     void NotifyScheduleStart();
@@ -40,17 +50,21 @@ private:
     bool GetIsCompleted(SimScenario& scenario) const;
 
     /* internal functions */
-    int GetPositionInNextRoad(const int& time, SimScenario& scenario, SimCar* car) const;
-    SimCar* PeekFirstPriorityCarOnRoad(const int& time, SimScenario& scenario, const SimRoad* road, const int& crossId) const;
-    bool PassCrossOrJustForward(const int& time, SimScenario& scenario, SimCar* car);
+    int GetPositionInNextRoad(const int& time, SimScenario& scenario, SimCar* car, UpdateResult& result) const;
+    SimCar* PeekFirstPriorityCarOnRoad(const int& time, SimScenario& scenario, const SimRoad* road, const int& crossId, UpdateResult& result) const;
+    bool PassCrossOrJustForward(const int& time, SimScenario& scenario, SimCar* car, UpdateResult& result);
     bool GetCarOutFromGarage(const int& time, SimScenario& scenario, SimCar* car) const;
-    void GetOutFromGarage(const int& time, SimScenario& scenario) const;
+    int GetOutFromGarage(const int& time, SimScenario& scenario) const; //return cars got out
     void InitializeCarsInGarage(const int& time, SimScenario& scenario);
-    void GetVipOutFromGarage(const int& time, SimScenario& scenario, const int& crossId = -1, const int& roadId = -1);
+    int GetVipOutFromGarage(const int& time, SimScenario& scenario, const int& crossId = -1, const int& roadId = -1); //return cars got out
+    static int UpdateCarsInLane(const int& time, SimScenario& scenario, SimRoad* &road, const int& lane, const bool& opposite, const bool& canBreak); //return cars moved
+    static int UpdateCarsInRoad(const int& time, SimScenario& scenario, SimRoad* road);
 
     /* cheater */
     bool m_isEnableCheater;
 
+    friend class MicroBench; //runs the kernels alone
+
 public:
     static Simulator Instance;
 
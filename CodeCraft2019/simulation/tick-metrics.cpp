@@ -0,0 +1,96 @@
+#include "tick-metrics.h"
+#include <cstring>
+
+namespace
+{
+    const int FieldsN = 10;
+    const char* FieldNames[FieldsN] =
+    {
+        "time",
+        "conflict",
+        "cycles",
+        "cross_visits",
+        "pass_cross_calls",
+        "pass_cross_progress",
+        "phase1_moved",
+        "garage_released",
+        "first_priority_reroutes",
+        "spend_us"
+    };
+}
+
+TickMetricsWriter::TickMetricsWriter()
+    : m_writer(1 << 16, AsyncWriter::BLOCK), m_line(1 << 10), m_format(CSV)
+{ }
+
+TickMetricsWriter::~TickMetricsWriter()
+{
+    Close();
+}
+
+bool TickMetricsWriter::ParseFormat(const char* name, Format& format)
+{
+    if (strcmp(name, "csv") == 0)
+        format = CSV;
+    else if (strcmp(name, "json") == 0)
+        format = JSON;
+    else
+        return false;
+    return true;
+}
+
+bool TickMetricsWriter::Open(const char* file, const Format& format)
+{
+    Close();
+    if (!m_writer.Open(file))
+        return false;
+    m_format = format;
+    if (m_format == CSV)
+    {
+        m_line.Clear();
+        for (int i = 0; i < FieldsN; ++i)
+            m_line.Write(i == 0 ? "" : ",").Write(FieldNames[i]);
+        m_line.Write('\n');
+        m_writer.Write(m_line.GetData(), m_line.GetSize());
+    }
+    return true;
+}
+
+void TickMetricsWriter::Close()
+{
+    if (m_writer.GetIsOpen())
+        m_writer.Close();
+}
+
+void TickMetricsWriter::Record(const int& time, const Simulator::UpdateResult& result)
+{
+    if (!m_writer.GetIsOpen())
+        return;
+    int values[FieldsN] =
+    {
+        time,
+        result.Conflict ? 1 : 0,
+        result.CyclesN,
+        result.CrossVisitsN,
+        result.PassCrossCallsN,
+        result.PassCrossProgressN,
+        result.Phase1MovedCarsN,
+        result.GarageReleasedN,
+        result.FirstPriorityReroutesN,
+        result.SpendMicroseconds
+    };
+    m_line.Clear();
+    if (m_format == CSV)
+    {
+        for (int i = 0; i < FieldsN; ++i)
+            m_line.Write(i == 0 ? "" : ",").Write(values[i]);
+        m_line.Write('\n');
+    }
+    else
+    {
+        for (int i = 0; i < FieldsN; ++i)
+            m_line.Write(i == 0 ? "{\"" : ",\"").Write(FieldNames[i]).Write("\":").Write(values[i]);
+        m_line.Write("}\n");
+    }
+    m_writer.Write(m_line.GetData(), m_line.GetSize());
+}
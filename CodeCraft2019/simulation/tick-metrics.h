@@ -0,0 +1,57 @@
+#ifndef TICK_METRICS_H
+#define TICK_METRICS_H
+
+#include "simulator.h"
+#include "buffered-writer.h"
+#include "async-writer.h"
+
+/*
+ * exports counters of Simulator::UpdateResult, one record for each tick
+ *   CSV  : a header line, then time,conflict,cycles,... for each tick
+ *   JSON : one object for each line (JSON lines), keys are the names of the CSV header
+ *   ticks may be recorded again with the same or an earlier time after a roll back
+ */
+class TickMetricsWriter
+{
+public:
+    enum Format
+    {
+        CSV,
+        JSON
+    };
+
+    TickMetricsWriter();
+    ~TickMetricsWriter();
+
+    bool Open(const char* file, const Format& format);
+    void Close();
+    void Record(const int& time, const Simulator::UpdateResult& result);
+    inline bool GetIsOpen() const;
+
+    static bool ParseFormat(const char* name, Format& format); //"csv" or "json"
+
+private:
+    TickMetricsWriter(const TickMetricsWriter& o); //not copyable
+    TickMetricsWriter& operator = (const TickMetricsWriter& o);
+
+    AsyncWriter m_writer;
+    BufferedWriter m_line;
+    Format m_format;
+
+};//class TickMetricsWriter
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline bool TickMetricsWriter::GetIsOpen() const
+{
+    return m_writer.GetIsOpen();
+}
+
+#endif
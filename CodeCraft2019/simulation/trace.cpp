@@ -2,12 +2,14 @@
 #include "assert.h"
 
 Trace::Trace()
+    : m_version(0)
 {
     m_container.push_back(-1);
     m_end = 0;
 }
 
 Trace::Trace(const Trace& o)
+    : m_version(0)
 {
     *this = o;
 }
@@ -17,6 +19,7 @@ Trace& Trace::operator = (const Trace& o)
     m_container = o.m_container;
     m_container.push_back(-1);
     m_end = o.m_end;
+    ++m_version;
     return *this;
 }
 
@@ -25,6 +28,7 @@ void Trace::RemoveFromTail()
     ASSERT(m_end != 0);
     --m_end;
     m_container[m_end] = -1;
+    ++m_version;
 }
 
 void Trace::AddToTail(int id)
@@ -32,6 +36,7 @@ void Trace::AddToTail(int id)
     ASSERT(id >= 0);
     m_container[m_end] = id;
     ++m_end;
+    ++m_version;
     if (m_end == m_container.size())
     {
         m_container.push_back(-1);
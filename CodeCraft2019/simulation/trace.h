@@ -13,6 +13,7 @@ public:
 private:
     Container m_container;
     std::size_t m_end;
+    unsigned int m_version; //changed with every modification, for validating caches based on the trace
     
 public:
     Trace();
@@ -25,6 +26,7 @@ public:
     inline NodeConst Tail() const;
 
     const std::size_t& Size() const;
+    inline const unsigned int& GetVersion() const;
     void RemoveFromTail();
     void AddToTail(int id);
     void Clear(const std::size_t& untill);
@@ -88,6 +90,11 @@ inline const std::size_t& Trace::Size() const
     return m_end;
 }
 
+inline const unsigned int& Trace::GetVersion() const
+{
+    return m_version;
+}
+
 inline int& Trace::operator [] (const std::size_t& index)
 {
     return m_container[index];
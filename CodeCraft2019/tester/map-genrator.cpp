@@ -2,6 +2,7 @@
 #include "random.h"
 #include "assert.h"
 #include <fstream>
+#include <algorithm>
 #include "log.h"
 #include "config.h"
 #include "sim-car.h"
@@ -140,7 +141,7 @@ void MapGenerator::GenerateMap()
                         tmpSstart = id + 1;
                         tmpEnd = id;
                     }
-                    m_roads.insert(std::make_pair(idHorizon, Road(idHorizon, 0, GetLength(), GetLimit(), GetLanes(), tmpSstart, tmpEnd, geneHorizon == 2)));
+                    m_roads.insert(std::make_pair(idHorizon, Road(idHorizon, idHorizon, GetLength(), GetLimit(), GetLanes(), tmpSstart, tmpEnd, geneHorizon == 2)));
                 }
                 if (geneVertical > 0)
                 {
@@ -151,14 +152,14 @@ void MapGenerator::GenerateMap()
                         tmpSstart = id + width;
                         tmpEnd = id;
                     }
-                    m_roads.insert(std::make_pair(idVertical, Road(idVertical, 0, GetLength(), GetLimit(), GetLanes(), tmpSstart, tmpEnd, geneVertical == 2)));
+                    m_roads.insert(std::make_pair(idVertical, Road(idVertical, idVertical, GetLength(), GetLimit(), GetLanes(), tmpSstart, tmpEnd, geneVertical == 2)));
                 }
             }//create road
             Road* north = i > 0 ? m_crosses[(i - 1) * width + j + 1].GetSouthRoad() : 0;
             Road* west = j > 0 ? m_crosses[id - 1].GetEasthRoad() : 0;
             Road* east = geneHorizon > 0 ? &m_roads[idHorizon] : 0;
             Road* south = geneVertical > 0 ? &m_roads[idVertical] : 0;
-            Cross& cross = m_crosses.insert(std::make_pair(id, Cross(id, 0
+            Cross& cross = m_crosses.insert(std::make_pair(id, Cross(id, id
                 , north != 0 ? north->GetId() : -1
                 , east != 0 ? east->GetId() : -1
                 , south != 0 ? south->GetId() : -1
@@ -273,7 +274,7 @@ void MapGenerator::SaveToFile() const
                 << ", " << car.GetMaxSpeed()
                 << ", " << car.GetPlanTime()
                 << ", " << car.GetIsVip()
-                << ", " << (m_preset.find(car.GetId()) != m_preset.end() ? '1' : '0')
+                << ", " << (m_preset.find(car.GetOriginId()) != m_preset.end() ? '1' : '0')
                 << ")\n";
         }
         ofs.flush();
@@ -291,7 +292,7 @@ void MapGenerator::SaveToFile() const
             ASSERT(car->GetTrace().Head() != car->GetTrace().Tail());
             for (auto traceIte = car->GetTrace().Head(); traceIte != car->GetTrace().Tail(); ++traceIte)
             {
-                ofs << ", " << *traceIte;
+                ofs << ", " << Scenario::Roads()[*traceIte]->GetOriginId();
             }
             ofs << ")\n";
         }
@@ -319,9 +320,11 @@ void MapGenerator::Generate(int argc, char *argv[])
     int maxCrossId = m_width * m_height;
     for (int i = 0; i < m_carsN; ++i)
     {
-        int start = Random::Uniform(0, maxCrossId) + 1;
-        int dealta = Random::Uniform(1, maxCrossId);
+        int start = (int)Random::Uniform(0, maxCrossId) % maxCrossId; //0-based here, never the same cross
+        int dealta = (int)Random::Uniform(1, maxCrossId);
+        dealta = std::min(std::max(dealta, 1), maxCrossId - 1);
         int end = (start + dealta) % maxCrossId + 1;
+        ++start;
         int id = i + 10001;
         m_cars.insert(std::make_pair(id, Car(id, 0, start, end, GetSpeed(), GetPlanTime(), Random::Uniform() < m_vipProb, false)));
     }
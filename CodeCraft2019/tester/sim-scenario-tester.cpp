@@ -13,7 +13,9 @@ double SimScenariotTester::WaitingProb(0.5);
 
 SimScenariotTester::SimScenariotTester()
 {
-    m_simGarages.clear();
+    for (uint i = 0; i < m_simGarages.size(); ++i)
+        m_simGarages[i].clear();
+    m_garagePositions.assign(m_garagePositions.size(), -1);
 
     int carIndex = 10000;
     Cross* cross = 0;
@@ -79,7 +81,7 @@ SimScenariotTester::SimScenariotTester()
                     }
                     car->GetCar()->SetMaxSpeed(Random::Uniform(1, 9));
                     car->UpdateOnRoad(1, road->GetRoad(), i, !road->GetRoad()->IsFromOrTo(cross->GetId()), road->GetRoad()->GetLength() - pos);
-                    road->RunIn(car->GetCar(), i, road->GetRoad()->IsFromOrTo(cross->GetId()));
+                    road->RunIn(car->GetCar(), i, road->GetRoad()->IsFromOrTo(cross->GetId()), road->GetRoad()->GetLength() - pos);
                     LOG("generate passing cross " << *car->GetCar()
                         << " next " << "(" << (nextId == roadId ? -1 : nextId) << ")"
                         << " dir " << (nextId == roadId ? Cross::DIRECT : cross->GetTurnDirection(roadId, nextId))
@@ -102,10 +104,11 @@ SimScenariotTester::SimScenariotTester()
                     bool waiting = Random::Uniform() < WaitingProb;
                     car->UpdateOnRoad((waiting ? 1 : 2), road->GetRoad(), i, road->GetRoad()->IsFromOrTo(cross->GetId()), pos);
                     if (waiting) car->SetIsIgnored(true);
-                    road->RunIn(car->GetCar(), i, !road->GetRoad()->IsFromOrTo(cross->GetId()));
+                    road->RunIn(car->GetCar(), i, !road->GetRoad()->IsFromOrTo(cross->GetId()), pos);
                     LOG("generate " << (waiting ? "waiting" : "scheduled") << " block cross car [" << car->GetCar()->GetOriginId() << "]");
                 }
             }
         }
     }
+    RebuildGarageIndex(); //cars are moved
 }
@@ -0,0 +1,299 @@
+#include "binary-trace.h"
+#include "buffered-writer.h"
+#include "async-writer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * offline queries over a binary trace (see BinaryTrace), frames are streamed one by one,
+ * memory is one block, the lanes of one frame and some numbers for each car & road
+ */
+class TraceTool
+{
+private:
+    BinaryTraceReader m_reader;
+    AsyncWriter m_output;
+    BufferedWriter m_line;
+    std::vector<int> m_laneRoads; //directed lane -> road index
+    std::vector<int> m_laneDirections; //directed lane -> [0] forward, [1] backward
+    std::vector<int> m_laneNumbers; //directed lane -> lane [1~lanes]
+
+    bool Open(const char* trace, const char* output)
+    {
+        if (!m_reader.Open(trace))
+        {
+            fprintf(stderr, "can not read trace %s\n", trace);
+            return false;
+        }
+        if (!m_output.Open(output))
+        {
+            fprintf(stderr, "can not write %s\n", output);
+            return false;
+        }
+        const std::vector<BinaryTrace::TraceRoad>& roads = m_reader.GetRoads();
+        for (unsigned int i = 0; i < roads.size(); ++i)
+        {
+            for (int direction = 0; direction < (roads[i].IsTwoWay ? 2 : 1); ++direction)
+            {
+                for (int lane = 1; lane <= roads[i].Lanes; ++lane)
+                {
+                    m_laneRoads.push_back(i);
+                    m_laneDirections.push_back(direction);
+                    m_laneNumbers.push_back(lane);
+                }
+            }
+        }
+        return true;
+    }
+
+    void Emit()
+    {
+        m_output.Write(m_line.GetData(), m_line.GetSize());
+        m_line.Clear();
+    }
+
+    int Close()
+    {
+        m_output.Close();
+        if (m_reader.GetIsBroken())
+        {
+            fprintf(stderr, "trace is broken or truncated after time %d\n", m_reader.GetTime());
+            return 1;
+        }
+        return 0;
+    }
+
+    int FindCar(const int& originId) const
+    {
+        const std::vector<int>& ids = m_reader.GetCarOriginIds();
+        for (unsigned int i = 0; i < ids.size(); ++i)
+            if (ids[i] == originId)
+                return i;
+        return -1;
+    }
+
+public:
+    TraceTool()
+        : m_output(1 << 20, AsyncWriter::BLOCK), m_line(1 << 16)
+    { }
+
+    /* the layout of log.tr written by Scheduler before */
+    int ToText(const char* trace, const char* output)
+    {
+        if (!Open(trace, output))
+            return 1;
+        const std::vector<BinaryTrace::TraceRoad>& roads = m_reader.GetRoads();
+        const std::vector<int>& carOriginIds = m_reader.GetCarOriginIds();
+        std::vector<int> cells;
+        while (m_reader.Next())
+        {
+            m_line.Write("time:").Write(m_reader.GetTime()).Write('\n');
+            for (unsigned int iRoad = 0; iRoad < roads.size(); ++iRoad)
+            {
+                const BinaryTrace::TraceRoad& road = roads[iRoad];
+                for (int direction = 0; direction < (road.IsTwoWay ? 2 : 1); ++direction)
+                {
+                    if (direction != 0)
+                        m_line.Write('\n');
+                    m_line.Write('(').Write(road.OriginId).Write(direction == 0 ? ",forward,[" : ",backward,[");
+                    for (int i = 0; i < road.Lanes; ++i)
+                    {
+                        const std::vector<int>& lane = m_reader.GetLane(road.FirstLane + direction * road.Lanes + i);
+                        cells.assign(road.Length + 1, -1);
+                        for (unsigned int iCar = 0; iCar < lane.size(); iCar += 2)
+                            cells[lane[iCar + 1]] = carOriginIds[lane[iCar]];
+                        m_line.Write(i == 0 ? "[" : ",[");
+                        for (int position = road.Length; position > 0; --position)
+                        {
+                            if (position != road.Length)
+                                m_line.Write(',');
+                            m_line.Write(cells[position]);
+                        }
+                        m_line.Write(']');
+                    }
+                    m_line.Write("])");
+                }
+                m_line.Write('\n');
+            }
+            Emit();
+        }
+        return Close();
+    }
+
+    /* time,road,direction,lane,position of one car, a line whenever it changes, road -1 means not on road */
+    int Car(const char* trace, const char* output, const int& carOriginId)
+    {
+        if (!Open(trace, output))
+            return 1;
+        int car = FindCar(carOriginId);
+        if (car < 0)
+        {
+            fprintf(stderr, "no car %d in trace\n", carOriginId);
+            Close();
+            return 1;
+        }
+        const std::vector<BinaryTrace::TraceRoad>& roads = m_reader.GetRoads();
+        int currentLane = -1;
+        int currentPosition = -1;
+        m_line.Write("time,road,direction,lane,position\n");
+        while (m_reader.Next())
+        {
+            const std::vector<int>& changed = m_reader.GetChangedLanes();
+            bool isLaneChanged = false;
+            for (unsigned int i = 0; i < changed.size() && !isLaneChanged; ++i)
+                isLaneChanged = changed[i] == currentLane;
+            if (currentLane >= 0 && !isLaneChanged)
+                continue; //nothing can have changed
+            int lane = -1;
+            int position = -1;
+            for (unsigned int i = 0; i < changed.size() && lane < 0; ++i)
+            {
+                const std::vector<int>& cars = m_reader.GetLane(changed[i]);
+                for (unsigned int iCar = 0; iCar < cars.size(); iCar += 2)
+                {
+                    if (cars[iCar] == car)
+                    {
+                        lane = changed[i];
+                        position = cars[iCar + 1];
+                        break;
+                    }
+                }
+            }
+            if (lane == currentLane && position == currentPosition)
+                continue;
+            currentLane = lane;
+            currentPosition = position;
+            m_line.Write(m_reader.GetTime()).Write(',');
+            if (lane < 0)
+                m_line.Write("-1,,,\n");
+            else
+                m_line.Write(roads[m_laneRoads[lane]].OriginId)
+                    .Write(m_laneDirections[lane] == 0 ? ",forward," : ",backward,")
+                    .Write(m_laneNumbers[lane]).Write(',').Write(position).Write('\n');
+            Emit();
+        }
+        return Close();
+    }
+
+    /* time,road,forward,backward : cars on each road for each frame, or only for one road */
+    int Occupancy(const char* trace, const char* output, const int& roadOriginId, const bool& isAllRoads)
+    {
+        if (!Open(trace, output))
+            return 1;
+        const std::vector<BinaryTrace::TraceRoad>& roads = m_reader.GetRoads();
+        std::vector<int> carsN(roads.size() * 2, 0); //road * 2 + direction -> cars
+        m_line.Write("time,road,forward,backward\n");
+        while (m_reader.Next())
+        {
+            const std::vector<int>& changed = m_reader.GetChangedLanes();
+            for (unsigned int i = 0; i < changed.size(); ++i)
+            {
+                int road = m_laneRoads[changed[i]];
+                int direction = m_laneDirections[changed[i]];
+                int n = 0;
+                for (int lane = 0; lane < roads[road].Lanes; ++lane)
+                    n += m_reader.GetLane(roads[road].FirstLane + direction * roads[road].Lanes + lane).size() / 2;
+                carsN[road * 2 + direction] = n;
+            }
+            for (unsigned int iRoad = 0; iRoad < roads.size(); ++iRoad)
+            {
+                if (!isAllRoads && roads[iRoad].OriginId != roadOriginId)
+                    continue;
+                m_line.Write(m_reader.GetTime()).Write(',').Write(roads[iRoad].OriginId).Write(',')
+                    .Write(carsN[iRoad * 2]).Write(',');
+                if (roads[iRoad].IsTwoWay)
+                    m_line.Write(carsN[iRoad * 2 + 1]);
+                m_line.Write('\n');
+            }
+            Emit();
+        }
+        return Close();
+    }
+
+    /*
+     * the simulator rolls back when a dead lock is found, so a frame with time not after the last one
+     * means a dead lock formed at the last frame; a trace ending with frames in which nothing moves
+     * but cars are still on road means a dead lock nobody solved
+     */
+    int DeadLock(const char* trace, const char* output)
+    {
+        if (!Open(trace, output))
+            return 1;
+        int lastTime = -1;
+        bool isFirst = true;
+        int carsOnRoad = 0;
+        int frozenSince = -1;
+        std::vector<int> laneCarsN(m_reader.GetLanesN(), 0);
+        m_line.Write("event,time,back_to\n");
+        while (m_reader.Next())
+        {
+            const std::vector<int>& changed = m_reader.GetChangedLanes();
+            for (unsigned int i = 0; i < changed.size(); ++i)
+            {
+                int n = m_reader.GetLane(changed[i]).size() / 2;
+                carsOnRoad += n - laneCarsN[changed[i]];
+                laneCarsN[changed[i]] = n;
+            }
+            if (!isFirst && m_reader.GetTime() <= lastTime)
+            {
+                m_line.Write("rollback,").Write(lastTime).Write(',').Write(m_reader.GetTime()).Write('\n');
+                Emit();
+                frozenSince = -1;
+            }
+            else if (changed.size() == 0 && carsOnRoad > 0)
+            {
+                if (frozenSince < 0)
+                    frozenSince = lastTime;
+            }
+            else
+            {
+                frozenSince = -1;
+            }
+            isFirst = false;
+            lastTime = m_reader.GetTime();
+        }
+        if (frozenSince >= 0)
+        {
+            m_line.Write("frozen,").Write(frozenSince).Write(",\n");
+            Emit();
+        }
+        return Close();
+    }
+
+    static int Usage()
+    {
+        fprintf(stderr,
+            "usage : trace-tool <command> <binary trace> <output> [id]\n"
+            "  text      : convert to the text layout of log.tr\n"
+            "  car       : trajectory of the car with origin id [id]\n"
+            "  occupancy : cars on each road for each frame, only road [id] if given\n"
+            "  deadlock  : times of roll backs and of a final dead lock\n");
+        return 2;
+    }
+
+    int Run(int argc, char* argv[])
+    {
+        if (argc < 4)
+            return Usage();
+        std::string command(argv[1]);
+        if (command == "text")
+            return ToText(argv[2], argv[3]);
+        if (command == "car" && argc >= 5)
+            return Car(argv[2], argv[3], atoi(argv[4]));
+        if (command == "occupancy")
+            return Occupancy(argv[2], argv[3], argc >= 5 ? atoi(argv[4]) : 0, argc < 5);
+        if (command == "deadlock")
+            return DeadLock(argv[2], argv[3]);
+        return Usage();
+    }
+
+};//class TraceTool
+
+int main(int argc, char *argv[])
+{
+    TraceTool tool;
+    return tool.Run(argc, argv);
+}
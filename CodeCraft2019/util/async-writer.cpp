@@ -0,0 +1,167 @@
+#include "async-writer.h"
+#include <algorithm>
+#include <exception>
+#include <cstdlib>
+#include <cstring>
+
+/* never destroyed, writers which are static objects may be closed after other statics are gone */
+std::mutex* RegistryMutex = new std::mutex();
+std::vector<AsyncWriter*>* Registry = new std::vector<AsyncWriter*>();
+std::terminate_handler PreviousTerminate = 0;
+bool IsTerminateInstalled = false;
+
+AsyncWriter::AsyncWriter(const std::size_t& bufferSize, const Backpressure& backpressure)
+    : m_file(0), m_bufferSize(bufferSize), m_backpressure(backpressure)
+    , m_front(0), m_frontSize(0), m_droppedBytes(0), m_waitsN(0)
+    , m_isPending(false), m_pendingSize(0), m_isStopping(false)
+{ }
+
+AsyncWriter::~AsyncWriter()
+{
+    Close();
+}
+
+bool AsyncWriter::Open(const char* file)
+{
+    Close();
+    m_file = fopen(file, "wb");
+    if (m_file == 0)
+        return false;
+    for (int i = 0; i < 2; ++i)
+        m_buffers[i].resize(m_bufferSize);
+    m_front = 0;
+    m_frontSize = 0;
+    m_isPending = false;
+    m_pendingSize = 0;
+    m_isStopping = false;
+    m_thread = std::thread(&AsyncWriter::WriterLoop, this);
+    Register(this);
+    return true;
+}
+
+void AsyncWriter::Close()
+{
+    if (m_file == 0)
+        return;
+    Unregister(this);
+    Submit(true);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_readyCondition.notify_one();
+    m_thread.join();
+    fclose(m_file);
+    m_file = 0;
+    for (int i = 0; i < 2; ++i)
+        std::vector<char>().swap(m_buffers[i]);
+}
+
+void AsyncWriter::Write(const void* data, const std::size_t& size)
+{
+    if (m_file == 0)
+        return;
+    if (m_frontSize + size > m_bufferSize && !Submit(m_backpressure == BLOCK))
+    {
+        m_droppedBytes += size;
+        return;
+    }
+    //a record larger than one buffer always waits, there is no other way to keep it
+    const char* p = (const char*)data;
+    std::size_t left = size;
+    while (left > 0)
+    {
+        if (m_frontSize == m_bufferSize)
+            Submit(true);
+        std::size_t n = std::min(left, m_bufferSize - m_frontSize);
+        memcpy(&m_buffers[m_front][m_frontSize], p, n);
+        m_frontSize += n;
+        p += n;
+        left -= n;
+    }
+}
+
+void AsyncWriter::Flush()
+{
+    if (m_file == 0)
+        return;
+    Submit(true);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_isPending)
+        m_freeCondition.wait(lock);
+    fflush(m_file); //the writer thread is idle now
+}
+
+bool AsyncWriter::Submit(bool isWait)
+{
+    if (m_frontSize == 0)
+        return true;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_isPending)
+    {
+        if (!isWait)
+            return false;
+        ++m_waitsN;
+        while (m_isPending)
+            m_freeCondition.wait(lock);
+    }
+    m_isPending = true;
+    m_pendingSize = m_frontSize;
+    m_front ^= 1;
+    m_frontSize = 0;
+    lock.unlock();
+    m_readyCondition.notify_one();
+    return true;
+}
+
+void AsyncWriter::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        while (!m_isPending && !m_isStopping)
+            m_readyCondition.wait(lock);
+        if (!m_isPending)
+            break; //stopping & nothing left
+        const char* data = &m_buffers[m_front ^ 1][0];
+        std::size_t size = m_pendingSize;
+        lock.unlock();
+        fwrite(data, 1, size, m_file);
+        lock.lock();
+        m_isPending = false;
+        m_freeCondition.notify_all();
+    }
+    fflush(m_file);
+}
+
+void AsyncWriter::FlushAll()
+{
+    std::lock_guard<std::mutex> lock(*RegistryMutex);
+    for (unsigned int i = 0; i < Registry->size(); ++i)
+        (*Registry)[i]->Flush();
+}
+
+void AsyncWriter::Register(AsyncWriter* writer)
+{
+    std::lock_guard<std::mutex> lock(*RegistryMutex);
+    Registry->push_back(writer);
+    if (!IsTerminateInstalled)
+    {
+        PreviousTerminate = std::set_terminate(&AsyncWriter::OnTerminate);
+        IsTerminateInstalled = true;
+    }
+}
+
+void AsyncWriter::Unregister(AsyncWriter* writer)
+{
+    std::lock_guard<std::mutex> lock(*RegistryMutex);
+    Registry->erase(std::remove(Registry->begin(), Registry->end(), writer), Registry->end());
+}
+
+void AsyncWriter::OnTerminate()
+{
+    FlushAll();
+    if (PreviousTerminate != 0)
+        PreviousTerminate();
+    abort();
+}
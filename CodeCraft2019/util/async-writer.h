@@ -0,0 +1,96 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+
+/*
+ * writes a file from a background thread with two fixed buffers (double buffering)
+ *   the producer fills the front buffer without locking, a full buffer is handed to the writer thread,
+ *   so the producer never waits for the disk unless both buffers are full, memory is 2 * buffer size
+ *   when both buffers are full :
+ *   - BLOCK : the producer waits for the writer thread (nothing is lost, for traces)
+ *   - DROP  : the whole incoming record is dropped and counted (for logs of less importance)
+ *   there is one producer thread for each writer, it is the thread invoking Write & Flush
+ *   every open writer is flushed at exit, also in std::terminate (an ASSERT thrown out of main)
+ */
+class AsyncWriter
+{
+public:
+    enum Backpressure
+    {
+        BLOCK,
+        DROP
+    };
+
+    AsyncWriter(const std::size_t& bufferSize = 1 << 20, const Backpressure& backpressure = BLOCK);
+    ~AsyncWriter();
+
+    bool Open(const char* file);
+    void Close(); //write all data left and stop the thread
+    void Write(const void* data, const std::size_t& size); //[data] is one record, it is never split by DROP
+    void Flush(); //return after all data written so far is in file
+    inline bool GetIsOpen() const;
+    inline const unsigned long long& GetDroppedBytes() const;
+    inline const unsigned long long& GetWaitsN() const; //times the producer waited for the writer thread
+
+    static void FlushAll();
+
+private:
+    AsyncWriter(const AsyncWriter& o); //not copyable
+    AsyncWriter& operator = (const AsyncWriter& o);
+
+    bool Submit(bool isWait); //hand the front buffer to the writer thread, [false] means it is still busy
+    void WriterLoop();
+    static void Register(AsyncWriter* writer);
+    static void Unregister(AsyncWriter* writer);
+    static void OnTerminate();
+
+    FILE* m_file;
+    std::size_t m_bufferSize;
+    Backpressure m_backpressure;
+    std::vector<char> m_buffers[2];
+    int m_front;
+    std::size_t m_frontSize;
+    unsigned long long m_droppedBytes;
+    unsigned long long m_waitsN;
+    std::thread m_thread;
+
+    /* guarded by m_mutex */
+    std::mutex m_mutex;
+    std::condition_variable m_readyCondition; //the back buffer is pending or stopping
+    std::condition_variable m_freeCondition; //the back buffer is written
+    bool m_isPending;
+    std::size_t m_pendingSize;
+    bool m_isStopping;
+
+};//class AsyncWriter
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline bool AsyncWriter::GetIsOpen() const
+{
+    return m_file != 0;
+}
+
+inline const unsigned long long& AsyncWriter::GetDroppedBytes() const
+{
+    return m_droppedBytes;
+}
+
+inline const unsigned long long& AsyncWriter::GetWaitsN() const
+{
+    return m_waitsN;
+}
+
+#endif
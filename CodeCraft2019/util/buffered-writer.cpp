@@ -0,0 +1,73 @@
+#include "buffered-writer.h"
+#include <cstdio>
+#include <string>
+
+#if defined(__linux__)
+    #include <unistd.h>
+#else
+    #include <process.h>
+    #include <windows.h>
+#endif //#if defined(__linux__)
+
+const char BufferedWriter::DigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+BufferedWriter::BufferedWriter(const std::size_t& reserve)
+    : m_size(0)
+{
+    Reserve(reserve);
+}
+
+void BufferedWriter::Clear()
+{
+    m_size = 0;
+}
+
+void BufferedWriter::Reserve(const std::size_t& size)
+{
+    if (size > m_buffer.size())
+        m_buffer.resize(size);
+}
+
+bool BufferedWriter::Commit(const char* file) const
+{
+    return CommitFile(file, GetData(), m_size);
+}
+
+bool BufferedWriter::CommitFile(const char* file, const void* data, const std::size_t& size)
+{
+    //one temporary file for each process, runs in parallel may save the same file
+#if defined(__linux__)
+    int pid = getpid();
+#else
+    int pid = _getpid();
+#endif //#if defined(__linux__)
+    std::string temp = std::string(file) + "." + std::to_string(pid) + ".tmp";
+    FILE* fp = fopen(temp.c_str(), "wb");
+    if (fp == 0)
+        return false;
+    setvbuf(fp, 0, _IONBF, 0); //the data is already buffered, pass it to the system with one call
+    bool written = size == 0 || fwrite(data, 1, size, fp) == size;
+    written = fclose(fp) == 0 && written;
+    if (written)
+    {
+        //replace the old file in one step, there is always a whole file even if killed here
+#if defined(__linux__)
+        written = rename(temp.c_str(), file) == 0;
+#else
+        written = MoveFileExA(temp.c_str(), file, MOVEFILE_REPLACE_EXISTING) != 0; //rename fails if [file] exists
+#endif //#if defined(__linux__)
+    }
+    if (!written)
+        remove(temp.c_str());
+    return written;
+}
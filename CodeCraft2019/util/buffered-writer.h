@@ -0,0 +1,141 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <vector>
+#include <cstring>
+
+/*
+ * formats text into one growing buffer, then writes it to file at once
+ *   the file is replaced through a temporary one and a rename,
+ *   so nobody ever sees a truncated file even if the program is killed in the middle
+ */
+class BufferedWriter
+{
+public:
+    BufferedWriter(const std::size_t& reserve = 0);
+
+    void Clear();
+    void Reserve(const std::size_t& size);
+    inline BufferedWriter& Write(const char& c);
+    inline BufferedWriter& Write(const char* str);
+    inline BufferedWriter& Write(int value);
+    inline BufferedWriter& Write(long long value);
+    inline const char* GetData() const;
+    inline const std::size_t& GetSize() const;
+
+    bool Commit(const char* file) const; //write the buffer as the whole content of file
+    /* write data to a temporary file of this process next to [file] with one call, then rename it to [file] */
+    static bool CommitFile(const char* file, const void* data, const std::size_t& size);
+
+private:
+    inline char* Append(const std::size_t& size); //return the place for [size] more chars
+
+    static const char DigitPairs[201];
+
+    std::vector<char> m_buffer;
+    std::size_t m_size;
+
+};//class BufferedWriter
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline char* BufferedWriter::Append(const std::size_t& size)
+{
+    if (m_size + size > m_buffer.size())
+        Reserve((m_size + size) * 2);
+    char* p = &m_buffer[m_size];
+    m_size += size;
+    return p;
+}
+
+inline BufferedWriter& BufferedWriter::Write(const char& c)
+{
+    *Append(1) = c;
+    return *this;
+}
+
+inline BufferedWriter& BufferedWriter::Write(const char* str)
+{
+    std::size_t length = strlen(str);
+    memcpy(Append(length), str, length);
+    return *this;
+}
+
+inline BufferedWriter& BufferedWriter::Write(int value)
+{
+    //digits are produced two by two from the end
+    char digits[12];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    while (u >= 100)
+    {
+        const char* pair = DigitPairs + (u % 100) * 2;
+        u /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (u >= 10)
+    {
+        const char* pair = DigitPairs + u * 2;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    else
+    {
+        *--p = (char)('0' + u);
+    }
+    if (value < 0)
+        *--p = '-';
+    memcpy(Append(end - p), p, end - p);
+    return *this;
+}
+
+inline BufferedWriter& BufferedWriter::Write(long long value)
+{
+    //same as int, wide enough for nanosecond clocks
+    char digits[21];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    unsigned long long u = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+    while (u >= 100)
+    {
+        const char* pair = DigitPairs + (u % 100) * 2;
+        u /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (u >= 10)
+    {
+        const char* pair = DigitPairs + u * 2;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    else
+    {
+        *--p = (char)('0' + u);
+    }
+    if (value < 0)
+        *--p = '-';
+    memcpy(Append(end - p), p, end - p);
+    return *this;
+}
+
+inline const char* BufferedWriter::GetData() const
+{
+    return m_size > 0 ? &m_buffer[0] : 0;
+}
+
+inline const std::size_t& BufferedWriter::GetSize() const
+{
+    return m_size;
+}
+
+#endif
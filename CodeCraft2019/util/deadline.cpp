@@ -0,0 +1,79 @@
+#include "deadline.h"
+#include "assert.h"
+
+CancelToken::CancelToken()
+    : m_isCancelled(false), m_hasDeadline(false)
+{ }
+
+CancelToken::CancelToken(const Clock::time_point& deadline)
+    : m_isCancelled(false), m_hasDeadline(true), m_deadline(deadline)
+{ }
+
+void CancelToken::Cancel()
+{
+    m_isCancelled.store(true);
+}
+
+double CancelToken::GetLeftTime() const
+{
+    if (m_isCancelled.load())
+        return 0;
+    if (!m_hasDeadline)
+        return 1e100;
+    return std::chrono::duration<double>(m_deadline - Clock::now()).count();
+}
+
+Deadline::Deadline()
+    : m_start(Clock::now()), m_total(0)
+{
+    for (int i = 0; i < PHASES_N; ++i)
+        m_budgets[i] = -1;
+}
+
+void Deadline::Start(const double& totalSeconds)
+{
+    m_start = Clock::now();
+    m_total = totalSeconds;
+}
+
+void Deadline::SetPhaseBudget(const Phase& phase, const double& seconds)
+{
+    ASSERT(phase >= 0 && phase < PHASES_N);
+    m_budgets[phase] = seconds;
+}
+
+double Deadline::GetSpendTime() const
+{
+    return std::chrono::duration<double>(Clock::now() - m_start).count();
+}
+
+double Deadline::GetLeftTime() const
+{
+    return m_total - GetSpendTime();
+}
+
+double Deadline::GetPhaseLeftTime(const Phase& phase) const
+{
+    return std::chrono::duration<double>(GetPhaseEnd(phase) - Clock::now()).count();
+}
+
+Deadline::Clock::time_point Deadline::GetPhaseEnd(const Phase& phase) const
+{
+    ASSERT(phase >= 0 && phase < PHASES_N);
+    double end = 0;
+    bool isBounded = true;
+    for (int i = 0; i <= phase; ++i)
+    {
+        if (m_budgets[i] < 0)
+            isBounded = false;
+        else
+            end += m_budgets[i];
+    }
+    double latest = m_total; //leave budgets of phases after it
+    for (int i = phase + 1; i < PHASES_N; ++i)
+        if (m_budgets[i] > 0)
+            latest -= m_budgets[i];
+    if (!isBounded || end > latest)
+        end = latest;
+    return m_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(end));
+}
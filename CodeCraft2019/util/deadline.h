@@ -0,0 +1,88 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <atomic>
+#include <chrono>
+
+/*
+ * cooperative cancellation, checked by long loops which stop at a safe point when it is cancelled
+ *   cancelled by Cancel() from any thread, or when the wall clock passes the deadline
+ */
+class CancelToken
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    CancelToken(); //only cancelled by Cancel()
+    CancelToken(const Clock::time_point& deadline);
+
+    void Cancel();
+    inline bool IsCancelled() const;
+    double GetLeftTime() const; //seconds, negative if passed
+
+private:
+    CancelToken(const CancelToken& o); //not copyable, pass pointer to the owner's token
+    CancelToken& operator = (const CancelToken& o);
+
+    std::atomic<bool> m_isCancelled;
+    bool m_hasDeadline;
+    Clock::time_point m_deadline;
+
+};//class CancelToken
+
+/*
+ * wall clock budget of the whole program split into phases in order
+ *   unlike Timer (CPU time of the process), it is not sped up by running threads
+ *   a phase ends after its own budget (from the start, after budgets of the phases before),
+ *   but always leaves budgets of the phases after it; a negative budget means all time left
+ */
+class Deadline
+{
+public:
+    typedef CancelToken::Clock Clock;
+
+    enum Phase
+    {
+        STABLE_RUN,
+        SEARCH,
+        FINAL_SAVE,
+        PHASES_N
+    };
+
+    Deadline();
+
+    void Start(const double& totalSeconds); //from now
+    void SetPhaseBudget(const Phase& phase, const double& seconds);
+    double GetSpendTime() const;
+    double GetLeftTime() const;
+    double GetPhaseLeftTime(const Phase& phase) const;
+    inline bool IsPhaseOver(const Phase& phase) const;
+    Clock::time_point GetPhaseEnd(const Phase& phase) const;
+
+private:
+    Clock::time_point m_start;
+    double m_total;
+    double m_budgets[PHASES_N];
+
+};//class Deadline
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline bool CancelToken::IsCancelled() const
+{
+    return m_isCancelled.load(std::memory_order_relaxed) || (m_hasDeadline && Clock::now() >= m_deadline);
+}
+
+inline bool Deadline::IsPhaseOver(const Phase& phase) const
+{
+    return Clock::now() >= GetPhaseEnd(phase);
+}
+
+#endif
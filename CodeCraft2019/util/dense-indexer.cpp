@@ -0,0 +1,95 @@
+#include "dense-indexer.h"
+#include <algorithm>
+
+const int DenseIndexer::NoneIndex(-1);
+
+DenseIndexer::DenseIndexer()
+{
+    Clear();
+}
+
+void DenseIndexer::Clear()
+{
+    m_inputs.clear();
+    m_isBuilt = false;
+    m_mode = CONSTANT_DIFFER;
+    m_differ = 0;
+    m_minKey = 0;
+    m_table.clear();
+    m_hashKeys.clear();
+    m_hashIndexes.clear();
+    m_hashMask = 0;
+    m_hashShift = 0;
+}
+
+void DenseIndexer::Input(const int& key, const int& index)
+{
+    ASSERT(index >= 0);
+    m_inputs.push_back(std::make_pair(key, index));
+    m_isBuilt = false;
+}
+
+bool DenseIndexer::Build()
+{
+    m_isBuilt = true;
+    m_table.clear();
+    m_hashKeys.clear();
+    m_hashIndexes.clear();
+
+    /* keys are inputted in order of indexes with a constant differ */
+    m_mode = CONSTANT_DIFFER;
+    m_differ = m_inputs.size() > 0 ? m_inputs[0].first - m_inputs[0].second : 0;
+    for (unsigned int i = 0; i < m_inputs.size() && m_mode == CONSTANT_DIFFER; ++i)
+        if (m_inputs[i].second != (int)i || m_inputs[i].first - m_inputs[i].second != m_differ)
+            m_mode = OFFSET_TABLE;
+    if (m_mode == CONSTANT_DIFFER)
+        return true; //keys are distinct as indexes are
+
+    /* keys in a compact range */
+    int minKey = m_inputs[0].first;
+    int maxKey = m_inputs[0].first;
+    for (unsigned int i = 1; i < m_inputs.size(); ++i)
+    {
+        minKey = std::min(minKey, m_inputs[i].first);
+        maxKey = std::max(maxKey, m_inputs[i].first);
+    }
+    long long range = (long long)maxKey - minKey + 1;
+    if (range <= (long long)m_inputs.size() * 4 + 1024)
+    {
+        m_mode = OFFSET_TABLE;
+        m_minKey = minKey;
+        m_table.resize((unsigned int)range, NoneIndex);
+        for (unsigned int i = 0; i < m_inputs.size(); ++i)
+        {
+            int& slot = m_table[m_inputs[i].first - minKey];
+            if (slot != NoneIndex)
+                return false;
+            slot = m_inputs[i].second;
+        }
+        return true;
+    }
+
+    /* sparse keys, the table is kept at most half full */
+    m_mode = HASH_TABLE;
+    int bits = 1;
+    while ((1u << bits) < m_inputs.size() * 2)
+        ++bits;
+    m_hashShift = 32 - bits;
+    m_hashMask = (1u << bits) - 1;
+    m_hashKeys.resize(1u << bits, 0);
+    m_hashIndexes.resize(1u << bits, NoneIndex);
+    for (unsigned int i = 0; i < m_inputs.size(); ++i)
+    {
+        const int& key = m_inputs[i].first;
+        unsigned int slot = Hash(key);
+        while (m_hashIndexes[slot] != NoneIndex)
+        {
+            if (m_hashKeys[slot] == key)
+                return false;
+            slot = (slot + 1) & m_hashMask;
+        }
+        m_hashKeys[slot] = key;
+        m_hashIndexes[slot] = m_inputs[i].second;
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef DENSE_INDEXER_H
+#define DENSE_INDEXER_H
+
+#include <vector>
+#include "assert.h"
+
+/*
+ * map integer keys (origin ids of input) to indexes, built once and looked up many times
+ *   keys are inputted first, then Build() picks the cheapest way of looking up :
+ *   - key minus index is constant (same detection as IndexerEnhanced), no table at all
+ *   - keys are in a compact range, an offset table
+ *   - otherwise an open addressing hash table
+ */
+class DenseIndexer
+{
+public:
+    const static int NoneIndex; //return NoneIndex means invalid key
+
+    enum Mode
+    {
+        CONSTANT_DIFFER,
+        OFFSET_TABLE,
+        HASH_TABLE
+    };
+
+    DenseIndexer();
+
+    void Clear();
+    void Input(const int& key, const int& index);
+    bool Build(); //[false] means some key is inputted more than once
+    inline int Output(const int& key) const;
+    inline int Size() const;
+    inline const Mode& GetMode() const;
+
+private:
+    inline unsigned int Hash(const int& key) const;
+
+    std::vector< std::pair<int, int> > m_inputs; //key, index
+    bool m_isBuilt;
+    Mode m_mode;
+    int m_differ; //key - index in CONSTANT_DIFFER mode
+    int m_minKey; //key of the first entry in OFFSET_TABLE mode
+    std::vector<int> m_table; //key - min key -> index in OFFSET_TABLE mode
+    std::vector<int> m_hashKeys; //slot -> key in HASH_TABLE mode
+    std::vector<int> m_hashIndexes; //slot -> index in HASH_TABLE mode, [NoneIndex] means empty slot
+    unsigned int m_hashMask;
+    int m_hashShift;
+
+};//class DenseIndexer
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline unsigned int DenseIndexer::Hash(const int& key) const
+{
+    return ((unsigned int)key * 2654435761u) >> m_hashShift; //Fibonacci hashing
+}
+
+inline int DenseIndexer::Output(const int& key) const
+{
+    ASSERT_MSG(m_isBuilt, "build the indexer before looking up");
+    switch (m_mode)
+    {
+    case CONSTANT_DIFFER:
+        {
+            int index = key - m_differ;
+            return index >= 0 && index < (int)m_inputs.size() ? index : NoneIndex;
+        }
+    case OFFSET_TABLE:
+        {
+            unsigned int offset = (unsigned int)(key - m_minKey);
+            return offset < m_table.size() ? m_table[offset] : NoneIndex;
+        }
+    default:
+        for (unsigned int slot = Hash(key); true; slot = (slot + 1) & m_hashMask)
+        {
+            if (m_hashIndexes[slot] == NoneIndex || m_hashKeys[slot] == key)
+                return m_hashIndexes[slot];
+        }
+    }
+}
+
+inline int DenseIndexer::Size() const
+{
+    return m_inputs.size();
+}
+
+inline const DenseIndexer::Mode& DenseIndexer::GetMode() const
+{
+    return m_mode;
+}
+
+#endif
@@ -1,9 +1,13 @@
 #include "file-reader.h"
-//#include "assert.h"
+#include "assert.h"
+#include "mapped-file.h"
+#include "thread-pool.h"
 #include <fstream>
 #include <sstream>
+#include <cstring>
 
-FileReader::FileReader()
+FileReader::FileReader(int threadsN)
+    : m_threadsN(threadsN)
 { }
 
 bool FileReader::Read(const char* file, Callback::Handle1<bool, std::istream&> callback) const
@@ -23,3 +27,134 @@ bool FileReader::Read(const char* file, Callback::Handle1<bool, std::istream&> c
     ifs.close();
     return true;
 }
+
+/* tuples of a part of file, the i-th one is Values[Offsets[i], Offsets[i + 1]) */
+struct TupleChunk
+{
+    const char* Begin;
+    const char* End;
+    std::vector<int> Values;
+    std::vector<int> Offsets;
+};
+
+class TupleChunkParser
+{
+private:
+    std::vector<TupleChunk>& m_chunks;
+
+public:
+    TupleChunkParser(std::vector<TupleChunk>& chunks)
+        : m_chunks(chunks)
+    { }
+
+    void Parse(int index)
+    {
+        TupleChunk& chunk = m_chunks[index];
+        std::vector<int> values;
+        values.reserve(64);
+        chunk.Offsets.push_back(0);
+        const char* p = chunk.Begin;
+        while (p < chunk.End)
+        {
+            p = FileReader::ParseTuple(p, chunk.End, values);
+            if (values.size() > 0)
+            {
+                chunk.Values.insert(chunk.Values.end(), values.begin(), values.end());
+                chunk.Offsets.push_back(chunk.Values.size());
+            }
+        }
+    }
+
+};//class TupleChunkParser
+
+const std::size_t ParallelParseMinSize = 1 << 20; //smaller files are not worth the threads
+
+bool FileReader::ReadTuples(const char* file, const Callback::Handle2<bool, const int*, const int&>& callback) const
+{
+    MappedFile mapped;
+    if (!mapped.Open(file))
+        return false;
+    const char* p = mapped.GetData();
+    const char* end = p + mapped.GetSize();
+    ThreadPool pool(m_threadsN);
+    if (pool.GetThreadsN() > 1 && mapped.GetSize() >= ParallelParseMinSize)
+    {
+        //split at line ends, so every chunk holds whole lines
+        std::vector<TupleChunk> chunks(pool.GetThreadsN());
+        for (unsigned int i = 0; i < chunks.size(); ++i)
+        {
+            const char* cut = i + 1 == chunks.size() ? end : mapped.GetData() + mapped.GetSize() / chunks.size() * (i + 1);
+            if (cut < p)
+                cut = p;
+            const char* lineEnd = (const char*)memchr(cut, '\n', end - cut);
+            chunks[i].Begin = p;
+            chunks[i].End = lineEnd == 0 ? end : lineEnd + 1;
+            p = chunks[i].End;
+        }
+        TupleChunkParser parser(chunks);
+        pool.ParallelFor(0, chunks.size(), Callback::Create(&TupleChunkParser::Parse, &parser));
+        for (unsigned int i = 0; i < chunks.size(); ++i)
+        {
+            const TupleChunk& chunk = chunks[i];
+            for (unsigned int j = 0; j + 1 < chunk.Offsets.size(); ++j)
+                if (!callback.Invoke(&chunk.Values[chunk.Offsets[j]], chunk.Offsets[j + 1] - chunk.Offsets[j]))
+                    return true;
+        }
+        return true;
+    }
+    std::vector<int> values;
+    values.reserve(64);
+    while (p < end)
+    {
+        p = ParseTuple(p, end, values);
+        if (values.size() > 0 && !callback.Invoke(&values[0], (int)values.size()))
+            break;
+    }
+    return true;
+}
+
+inline bool IsBlank(const char& c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool IsDigit(const char& c)
+{
+    return c >= '0' && c <= '9';
+}
+
+const char* FileReader::ParseTuple(const char* begin, const char* end, std::vector<int>& values)
+{
+    const char* p = begin;
+    values.clear();
+    while (p < end && IsBlank(*p))
+        ++p;
+    if (p < end && *p == '(')
+    {
+        ++p;
+        while (true)
+        {
+            while (p < end && IsBlank(*p))
+                ++p;
+            bool negative = p < end && *p == '-';
+            if (negative)
+                ++p;
+            ASSERT_MSG(p < end && IsDigit(*p), "expect a number at position " << values.size());
+            int value = 0;
+            while (p < end && IsDigit(*p))
+                value = value * 10 + (*p++ - '0');
+            values.push_back(negative ? -value : value);
+            while (p < end && IsBlank(*p))
+                ++p;
+            ASSERT_MSG(p < end && (*p == ',' || *p == ')'), "char=" << (p < end ? *p : ' ') << " position=" << values.size() - 1);
+            if (*p++ == ')')
+                break;
+        }
+    }
+    else
+    {
+        ASSERT_MSG(p == end || *p == '#' || *p == '\n', "char=" << *p);
+    }
+    const char* next = (const char*)memchr(p, '\n', end - p);
+    return next == 0 ? end : next + 1;
+}
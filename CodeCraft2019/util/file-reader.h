@@ -2,13 +2,28 @@
 #define FILE_READER_H
 
 #include <iostream>
+#include <vector>
 #include "callback.h"
 
 class FileReader
 {
+private:
+    int m_threadsN;
+
 public:
-    FileReader();
+    FileReader(int threadsN = 1); //threads for parsing large files, [0] means number of hardware threads
     bool Read(const char* file, Callback::Handle1<bool, std::istream&> callback) const;
+    /*
+     * read lines like "(a, b, ...)" from a mapped file, without any stream or copy of lines
+     *   blank lines and lines started with '#' are skipped
+     *   callback receives the integers of each line and the number of them, return false to stop
+     *   large files are split at line ends and parsed by threads, callback is still invoked in file order
+     */
+    bool ReadTuples(const char* file, const Callback::Handle2<bool, const int*, const int&>& callback) const;
+
+    /* parse the line started from [begin], return the start of next line
+     * [values] is cleared, then filled if the line is a tuple */
+    static const char* ParseTuple(const char* begin, const char* end, std::vector<int>& values);
     
 };//class FileReader
 
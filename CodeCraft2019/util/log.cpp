@@ -8,23 +8,47 @@ Log Log::Instance;
 
 void Log::Default(Log::LogLevel level)
 {
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
     Instance.m_default = level;
+    Instance.Refresh();
 }
 
 void Log::Set(std::string name, Log::LogLevel level)
 {
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
     Instance.m_map[name] = level;
+    Instance.Refresh();
 }
 
 Log::LogLevel Log::Get(std::string name)
 {
-    if (Instance.m_map.find(name) != Instance.m_map.end())
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
+    auto find = Instance.m_map.find(name);
+    if (find != Instance.m_map.end())
     {
-        return Instance.m_map[name];
+        return find->second;
     }
     return Instance.m_default;
 }
 
+Log::LogLevel Log::Register(const std::string& name, std::atomic<int>* level)
+{
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
+    if (level->load() == UNRESOLVED) //another thread may have registered it
+        Instance.m_categories.push_back(std::make_pair(name, level));
+    Instance.Refresh();
+    return (LogLevel)level->load();
+}
+
+void Log::Refresh()
+{
+    for (unsigned int i = 0; i < m_categories.size(); ++i)
+    {
+        auto find = m_map.find(m_categories[i].first);
+        m_categories[i].second->store(find != m_map.end() ? find->second : m_default, std::memory_order_relaxed);
+    }
+}
+
 void Log::Enable(std::string name)
 {
     Set(name, ENABLE);
@@ -35,21 +59,69 @@ void Log::Disable(std::string name)
     Set(name, DISABLE);
 }
 
-#include <fstream>
+#include "async-writer.h"
 #include "assert.h"
+
+/* stream buffer over an AsyncWriter, std::endl only moves the line into the writer, never to disk */
+class AsyncStreamBuffer : public std::streambuf
+{
+private:
+    AsyncWriter& m_writer;
+    char m_area[4096];
+
+    void Push()
+    {
+        m_writer.Write(pbase(), pptr() - pbase());
+        setp(m_area, m_area + sizeof(m_area));
+    }
+
+protected:
+    virtual int overflow(int c)
+    {
+        Push();
+        if (c != traits_type::eof())
+        {
+            *pptr() = (char)c;
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    virtual int sync()
+    {
+        Push();
+        return 0;
+    }
+
+public:
+    AsyncStreamBuffer(AsyncWriter& writer)
+        : m_writer(writer)
+    {
+        setp(m_area, m_area + sizeof(m_area));
+    }
+
+    ~AsyncStreamBuffer()
+    {
+        Push();
+    }
+
+};//class AsyncStreamBuffer
+
 std::ostream* Log::GetOutstream()
 {
     //return &std::cout;
+    static AsyncWriter writer(1 << 20, AsyncWriter::BLOCK);
     static bool init = false;
-    static std::ofstream ofs("log.txt");
+    static AsyncStreamBuffer buffer(writer);
+    static std::ostream os(&buffer);
     if (!init)
     {
-        if (!ofs.is_open())
+        if (!writer.Open("log.txt"))
         {
             std::cout << "initiliaze log stream failed" << std::endl;
             ASSERT(false);
         }
         init = true;
     }
-    return &ofs;
+    return &os;
 }
@@ -26,12 +26,16 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 class Log {
 public:
     enum LogLevel {
         DISABLE,
         ENABLE,
+        UNRESOLVED, //level of a category not registered yet
     };//enum LogLevel
 
 private:
@@ -40,6 +44,10 @@ private:
     
     LogLevel m_default;
     std::map<std::string, LogLevel> m_map;
+    std::mutex m_mutex;
+    std::vector< std::pair<std::string, std::atomic<int>*> > m_categories; //name, cached level of LogCategory
+
+    void Refresh(); //push levels of names to cached levels, m_mutex is locked
 
 public:
     template <typename _T>
@@ -69,10 +77,11 @@ public:
     }
 
     template <typename _T>
-    static LogLevel Get()
-    {
-        return Get(GetName<_T>());
-    }
+    static inline LogLevel Get();
+    template <typename _T>
+    static inline bool IsEnable(const _T& o); //for LOG_IS_ENABLE, _T is the type of *this
+
+    static LogLevel Register(const std::string& name, std::atomic<int>* level); //invoked once for each LogCategory
     
     template <typename _T>
     static void Enable()
@@ -90,8 +99,49 @@ public:
 
 };//class Log
 
+/*
+ * level of one class cached in a static, looked up by name only once
+ *   a disabled LOG costs one load and one branch, Log::Set still changes it at runtime
+ */
+template <typename _T>
+class LogCategory
+{
+public:
+    static std::atomic<int> Level;
+
+    static inline bool IsEnable()
+    {
+        int level = Level.load(std::memory_order_relaxed);
+        if (level == Log::DISABLE)
+            return false;
+        if (level == Log::ENABLE)
+            return true;
+        return Log::Register(Log::GetName<_T>(), &Level) == Log::ENABLE;
+    }
+
+private:
+    LogCategory();
+    virtual ~LogCategory() = 0;
+
+};//class LogCategory
+
+template <typename _T>
+std::atomic<int> LogCategory<_T>::Level(Log::UNRESOLVED);
+
+template <typename _T>
+inline Log::LogLevel Log::Get()
+{
+    return LogCategory<_T>::IsEnable() ? ENABLE : DISABLE;
+}
+
+template <typename _T>
+inline bool Log::IsEnable(const _T& o)
+{
+    return LogCategory<_T>::IsEnable();
+}
+
 #ifdef LOG_ON
-#define LOG_IS_ENABLE (Log::Get(Log::GetName(*this)) == Log::ENABLE)
+#define LOG_IS_ENABLE (Log::IsEnable(*this))
 
 #define LOG_IMPL(info, msg)                                 \
     do {                                                    \
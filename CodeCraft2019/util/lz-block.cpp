@@ -0,0 +1,120 @@
+#include "lz-block.h"
+#include <cstring>
+
+const int MinMatch = 4;
+const int HashBits = 12;
+const std::size_t MaxOffset = 65535;
+const std::size_t LastLiterals = 5; //the tail is always kept as literals, so matching never reads out of range
+
+inline unsigned int Read32(const char* p)
+{
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline unsigned int HashOf(const unsigned int& value)
+{
+    return (value * 2654435761u) >> (32 - HashBits);
+}
+
+inline void WriteLength(std::size_t length, std::vector<char>& dst)
+{
+    for (; length >= 255; length -= 255)
+        dst.push_back((char)255);
+    dst.push_back((char)length);
+}
+
+inline void WriteSequence(const char* literals, const std::size_t& literalsN, const std::size_t& offset, const std::size_t& matchN, std::vector<char>& dst)
+{
+    std::size_t matchCode = matchN >= (std::size_t)MinMatch ? matchN - MinMatch : 0;
+    unsigned char token = (unsigned char)(((literalsN < 15 ? literalsN : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    dst.push_back((char)token);
+    if (literalsN >= 15)
+        WriteLength(literalsN - 15, dst);
+    dst.insert(dst.end(), literals, literals + literalsN);
+    if (matchN == 0)
+        return; //the last sequence
+    dst.push_back((char)(offset & 0xff));
+    dst.push_back((char)(offset >> 8));
+    if (matchCode >= 15)
+        WriteLength(matchCode - 15, dst);
+}
+
+std::size_t LzBlock::Compress(const char* src, const std::size_t& size, std::vector<char>& dst)
+{
+    std::size_t begin = dst.size();
+    int table[1 << HashBits];
+    for (int i = 0; i < (1 << HashBits); ++i)
+        table[i] = -1;
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    std::size_t limit = size > LastLiterals + MinMatch ? size - LastLiterals - MinMatch : 0;
+    while (pos < limit)
+    {
+        unsigned int value = Read32(src + pos);
+        unsigned int hash = HashOf(value);
+        int candidate = table[hash];
+        table[hash] = (int)pos;
+        if (candidate < 0 || pos - candidate > MaxOffset || Read32(src + candidate) != value)
+        {
+            ++pos;
+            continue;
+        }
+        std::size_t matchN = MinMatch;
+        while (pos + matchN < size - LastLiterals && src[candidate + matchN] == src[pos + matchN])
+            ++matchN;
+        WriteSequence(src + anchor, pos - anchor, pos - candidate, matchN, dst);
+        pos += matchN;
+        anchor = pos;
+    }
+    WriteSequence(src + anchor, size - anchor, 0, 0, dst);
+    return dst.size() - begin;
+}
+
+inline bool ReadLength(const unsigned char*& p, const unsigned char* end, std::size_t& length)
+{
+    while (true)
+    {
+        if (p >= end)
+            return false;
+        unsigned char c = *p++;
+        length += c;
+        if (c != 255)
+            return true;
+    }
+}
+
+bool LzBlock::Decompress(const char* src, const std::size_t& size, char* dst, const std::size_t& dstSize)
+{
+    const unsigned char* p = (const unsigned char*)src;
+    const unsigned char* end = p + size;
+    std::size_t out = 0;
+    while (p < end)
+    {
+        unsigned char token = *p++;
+        std::size_t literalsN = token >> 4;
+        if (literalsN == 15 && !ReadLength(p, end, literalsN))
+            return false;
+        if ((std::size_t)(end - p) < literalsN || dstSize - out < literalsN)
+            return false;
+        memcpy(dst + out, p, literalsN);
+        p += literalsN;
+        out += literalsN;
+        if (p == end)
+            break; //the last sequence
+        if (end - p < 2)
+            return false;
+        std::size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+        std::size_t matchN = token & 15;
+        if (matchN == 15 && !ReadLength(p, end, matchN))
+            return false;
+        matchN += MinMatch;
+        if (offset == 0 || offset > out || dstSize - out < matchN)
+            return false;
+        for (std::size_t i = 0; i < matchN; ++i, ++out)
+            dst[out] = dst[out - offset]; //may overlap itself
+    }
+    return out == dstSize;
+}
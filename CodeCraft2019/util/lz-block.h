@@ -0,0 +1,28 @@
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <vector>
+#include <cstddef>
+
+/*
+ * small LZ77 block codec in the layout of LZ4 blocks
+ *   sequence : token (literals length << 4 | match length - 4), literals, 2 bytes offset
+ *   lengths not less than 15 are continued by bytes of 255 and a final byte
+ *   the last sequence has literals only
+ * it is fast enough to run on every block of a trace, not meant for the best ratio
+ */
+class LzBlock
+{
+public:
+    /* append compressed [src] to [dst], return the compressed size */
+    static std::size_t Compress(const char* src, const std::size_t& size, std::vector<char>& dst);
+    /* [dst] must have [dstSize] bytes, [false] means broken data */
+    static bool Decompress(const char* src, const std::size_t& size, char* dst, const std::size_t& dstSize);
+
+private:
+    LzBlock();
+    virtual ~LzBlock() = 0;
+
+};//class LzBlock
+
+#endif
@@ -0,0 +1,77 @@
+#include "mapped-file.h"
+#include <fstream>
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif //#if defined(__linux__)
+
+MappedFile::MappedFile()
+    : m_data(0), m_size(0), m_isOpen(false), m_isMapped(false)
+{ }
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const char* file)
+{
+    Close();
+#if defined(__linux__)
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    m_size = (std::size_t)st.st_size;
+    if (m_size > 0)
+    {
+        void* data = mmap(0, m_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = (const char*)data;
+            m_isMapped = true;
+        }
+    }
+    close(fd); //the mapping keeps its own reference of the file
+    if (m_size > 0 && !m_isMapped)
+    {
+        m_size = 0;
+        return false;
+    }
+#else
+    std::ifstream ifs(file, std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    ifs.seekg(0, std::ios::end);
+    m_size = (std::size_t)ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    m_buffer.resize(m_size);
+    if (m_size > 0)
+        ifs.read(&m_buffer[0], m_size);
+    m_data = m_size > 0 ? &m_buffer[0] : 0;
+#endif //#if defined(__linux__)
+    m_isOpen = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(__linux__)
+    if (m_isMapped)
+        munmap((void*)m_data, m_size);
+#endif //#if defined(__linux__)
+    std::vector<char>().swap(m_buffer);
+    m_data = 0;
+    m_size = 0;
+    m_isOpen = false;
+    m_isMapped = false;
+}
@@ -0,0 +1,61 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <vector>
+#include <cstddef>
+
+/*
+ * read only view of a whole file
+ *   the file is mapped into memory on linux, so pages are only loaded when touched
+ *   on other platforms it is read into a buffer at once
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const char* file);
+    void Close();
+
+    inline const char* GetData() const; //not terminated by '\0'
+    inline const std::size_t& GetSize() const;
+    inline const bool& GetIsOpen() const;
+
+private:
+    MappedFile(const MappedFile& o); //not copyable
+    MappedFile& operator = (const MappedFile& o);
+
+    const char* m_data;
+    std::size_t m_size;
+    bool m_isOpen;
+    bool m_isMapped;
+    std::vector<char> m_buffer;
+
+};//class MappedFile
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline const char* MappedFile::GetData() const
+{
+    return m_data;
+}
+
+inline const std::size_t& MappedFile::GetSize() const
+{
+    return m_size;
+}
+
+inline const bool& MappedFile::GetIsOpen() const
+{
+    return m_isOpen;
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "profiler.h"
+#include "buffered-writer.h"
+#include "log.h"
+#include <algorithm>
+
+Profiler Profiler::Instance;
+
+Profiler::ZoneStatistic::ZoneStatistic()
+    : Count(0), Total(0), Self(0), Min(0), Max(0)
+{ }
+
+Profiler::Profiler()
+    : m_isEnable(false), m_start(std::chrono::steady_clock::now()), m_maxEvents(0)
+{ }
+
+int Profiler::RegisterZone(const char* name)
+{
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
+    Instance.m_zoneNames.push_back(name);
+    return Instance.m_zoneNames.size() - 1;
+}
+
+void Profiler::SetEnable(const bool& enable)
+{
+    Instance.m_isEnable.store(enable);
+}
+
+void Profiler::SetRecordEvents(const std::size_t& maxEventsPerThread)
+{
+    Instance.m_maxEvents = maxEventsPerThread;
+}
+
+void Profiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
+    for (unsigned int i = 0; i < Instance.m_threads.size(); ++i)
+    {
+        ThreadProfile* profile = Instance.m_threads[i];
+        profile->Zones.clear();
+        profile->Events.clear();
+        profile->DroppedEventsN = 0;
+    }
+}
+
+Profiler::ThreadProfile* Profiler::CreateThreadProfile()
+{
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
+    ThreadProfile* profile = new ThreadProfile();
+    profile->Index = Instance.m_threads.size();
+    profile->DroppedEventsN = 0;
+    profile->Stack.reserve(64);
+    Instance.m_threads.push_back(profile);
+    return profile;
+}
+
+void Profiler::Print()
+{
+    Instance.DoPrint();
+}
+
+void Profiler::DoPrint()
+{
+    if (!LOG_IS_ENABLE)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    //merge threads, zones of different threads are summed
+    std::vector<ZoneStatistic> zones(m_zoneNames.size());
+    std::vector<int> threadsN(m_zoneNames.size(), 0);
+    for (unsigned int iThread = 0; iThread < m_threads.size(); ++iThread)
+    {
+        const std::vector<ZoneStatistic>& local = m_threads[iThread]->Zones;
+        for (unsigned int i = 0; i < local.size(); ++i)
+        {
+            if (local[i].Count == 0)
+                continue;
+            if (zones[i].Count == 0 || local[i].Min < zones[i].Min)
+                zones[i].Min = local[i].Min;
+            zones[i].Max = std::max(zones[i].Max, local[i].Max);
+            zones[i].Count += local[i].Count;
+            zones[i].Total += local[i].Total;
+            zones[i].Self += local[i].Self;
+            ++threadsN[i];
+        }
+    }
+    for (unsigned int i = 0; i < zones.size(); ++i)
+    {
+        if (zones[i].Count == 0)
+            continue;
+        LOG("Profile zone : " << m_zoneNames[i]
+            << " count " << zones[i].Count
+            << " threads " << threadsN[i]
+            << " total " << zones[i].Total / 1e6 << " ms"
+            << " self " << zones[i].Self / 1e6 << " ms"
+            << " average " << zones[i].Total / 1e3 / zones[i].Count << " us"
+            << " min " << zones[i].Min / 1e3 << " us"
+            << " max " << zones[i].Max / 1e3 << " us");
+    }
+    for (unsigned int iThread = 0; iThread < m_threads.size(); ++iThread)
+        if (m_threads[iThread]->DroppedEventsN > 0)
+            LOG("Profile thread " << iThread << " dropped events : " << m_threads[iThread]->DroppedEventsN);
+}
+
+bool Profiler::SaveChromeTrace(const char* file)
+{
+    std::lock_guard<std::mutex> lock(Instance.m_mutex);
+    BufferedWriter writer(1 << 20);
+    writer.Write("{\"traceEvents\":[\n");
+    bool isFirst = true;
+    for (unsigned int iThread = 0; iThread < Instance.m_threads.size(); ++iThread)
+    {
+        const std::vector<Event>& events = Instance.m_threads[iThread]->Events;
+        for (unsigned int i = 0; i < events.size(); ++i)
+        {
+            //complete events in microseconds, fractions kept by writing nanoseconds / 1000 with 3 decimals
+            if (!isFirst)
+                writer.Write(",\n");
+            isFirst = false;
+            writer.Write("{\"name\":\"").Write(Instance.m_zoneNames[events[i].Zone].c_str())
+                .Write("\",\"ph\":\"X\",\"pid\":0,\"tid\":").Write((int)iThread)
+                .Write(",\"ts\":").Write(events[i].Start / 1000).Write('.');
+            int fraction = (int)(events[i].Start % 1000);
+            writer.Write((char)('0' + fraction / 100)).Write((char)('0' + fraction / 10 % 10)).Write((char)('0' + fraction % 10));
+            writer.Write(",\"dur\":").Write(events[i].Duration / 1000).Write('.');
+            fraction = (int)(events[i].Duration % 1000);
+            writer.Write((char)('0' + fraction / 100)).Write((char)('0' + fraction / 10 % 10)).Write((char)('0' + fraction % 10));
+            writer.Write('}');
+        }
+    }
+    writer.Write("\n]}\n");
+    return writer.Commit(file);
+}
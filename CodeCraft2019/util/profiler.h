@@ -0,0 +1,193 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+/*
+ * scoped profiler for hot paths
+ *   a zone is registered once by name (static id), then entering & leaving it only touches
+ *   statistics of the current thread : no lock, no string, two reads of steady_clock
+ *   zones nest, self time of a zone excludes its children
+ *   disabled (default) : a scope costs one branch
+ *   Print() reports by LOG, SaveChromeTrace() writes events for chrome://tracing if they are recorded
+ */
+class Profiler
+{
+public:
+    static int RegisterZone(const char* name); //invoked once for each zone, see PROFILE_ZONE
+    static void SetEnable(const bool& enable);
+    static inline bool GetIsEnable();
+    static void SetRecordEvents(const std::size_t& maxEventsPerThread); //[0] means no events, only statistics
+    static void Reset();
+    static void Print();
+    static bool SaveChromeTrace(const char* file);
+
+    static inline void Begin(const int& zone);
+    static inline void End();
+
+private:
+    struct ZoneStatistic
+    {
+        ZoneStatistic();
+        unsigned long long Count;
+        long long Total; //nanoseconds
+        long long Self;
+        long long Min;
+        long long Max;
+    };//struct ZoneStatistic
+
+    struct Frame
+    {
+        int Zone;
+        long long Start;
+        long long Children;
+    };//struct Frame
+
+    struct Event
+    {
+        int Zone;
+        long long Start;
+        long long Duration;
+    };//struct Event
+
+    struct ThreadProfile
+    {
+        int Index;
+        std::vector<ZoneStatistic> Zones; //zone id -> statistic
+        std::vector<Frame> Stack;
+        std::vector<Event> Events;
+        unsigned long long DroppedEventsN;
+    };//struct ThreadProfile
+
+    Profiler();
+    static Profiler Instance;
+
+    std::atomic<bool> m_isEnable;
+    std::chrono::steady_clock::time_point m_start;
+    std::size_t m_maxEvents;
+    std::mutex m_mutex;
+    std::vector<std::string> m_zoneNames; //zone id -> name
+    std::vector<ThreadProfile*> m_threads; //never released, threads of pools may end before printing
+
+    static inline long long Now();
+    static inline ThreadProfile* GetThreadProfile();
+    static ThreadProfile* CreateThreadProfile();
+    void DoPrint();
+
+};//class Profiler
+
+/* enter a zone when constructed, leave it when destructed or stopped */
+class ProfileScope
+{
+public:
+    inline ProfileScope(const int& zone);
+    inline ~ProfileScope();
+    inline void Stop();
+
+private:
+    bool m_isActive;
+
+};//class ProfileScope
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+/* named scope, can be stopped by [var].Stop() before the end of block */
+#define PROFILE_SCOPE(var, name)                                            \
+    static const int PROFILE_CONCAT(var, ZoneId) = Profiler::RegisterZone(name); \
+    ProfileScope var(PROFILE_CONCAT(var, ZoneId))
+#define PROFILE_ZONE(name) PROFILE_SCOPE(PROFILE_CONCAT(profileScope, __LINE__), name)
+
+
+
+
+
+/*
+ * [inline functions]
+ *   it's not good to write code here, but we really need inline!
+ */
+
+inline bool Profiler::GetIsEnable()
+{
+    return Instance.m_isEnable.load(std::memory_order_relaxed);
+}
+
+inline long long Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Instance.m_start).count();
+}
+
+inline Profiler::ThreadProfile* Profiler::GetThreadProfile()
+{
+    static thread_local ThreadProfile* profile = 0;
+    if (profile == 0)
+        profile = CreateThreadProfile();
+    return profile;
+}
+
+inline void Profiler::Begin(const int& zone)
+{
+    ThreadProfile* profile = GetThreadProfile();
+    Frame frame;
+    frame.Zone = zone;
+    frame.Children = 0;
+    frame.Start = Now();
+    profile->Stack.push_back(frame);
+}
+
+inline void Profiler::End()
+{
+    long long now = Now();
+    ThreadProfile* profile = GetThreadProfile();
+    Frame frame = profile->Stack.back();
+    profile->Stack.pop_back();
+    long long duration = now - frame.Start;
+    if (frame.Zone >= (int)profile->Zones.size())
+        profile->Zones.resize(frame.Zone + 1);
+    ZoneStatistic& statistic = profile->Zones[frame.Zone];
+    if (statistic.Count == 0 || duration < statistic.Min)
+        statistic.Min = duration;
+    if (duration > statistic.Max)
+        statistic.Max = duration;
+    ++statistic.Count;
+    statistic.Total += duration;
+    statistic.Self += duration - frame.Children;
+    if (profile->Stack.size() > 0)
+        profile->Stack.back().Children += duration;
+    if (profile->Events.size() < Instance.m_maxEvents)
+    {
+        Event event;
+        event.Zone = frame.Zone;
+        event.Start = frame.Start;
+        event.Duration = duration;
+        profile->Events.push_back(event);
+    }
+    else if (Instance.m_maxEvents > 0)
+    {
+        ++profile->DroppedEventsN;
+    }
+}
+
+inline ProfileScope::ProfileScope(const int& zone)
+    : m_isActive(Profiler::GetIsEnable())
+{
+    if (m_isActive)
+        Profiler::Begin(zone);
+}
+
+inline ProfileScope::~ProfileScope()
+{
+    Stop();
+}
+
+inline void ProfileScope::Stop()
+{
+    if (m_isActive)
+        Profiler::End();
+    m_isActive = false;
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "thread-pool.h"
+#include "assert.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadsN)
+    : m_threadsN(0), m_isStopping(false), m_jobToken(0), m_busyN(0), m_begin(0), m_end(0), m_callback(0)
+{
+    SetThreadsN(threadsN);
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+void ThreadPool::SetThreadsN(int threadsN)
+{
+    if (threadsN <= 0)
+        threadsN = (int)std::thread::hardware_concurrency();
+    if (threadsN <= 0)
+        threadsN = 1;
+    if (threadsN == m_threadsN)
+        return;
+    Stop();
+    m_threadsN = threadsN;
+}
+
+const int& ThreadPool::GetThreadsN() const
+{
+    return m_threadsN;
+}
+
+void ThreadPool::Start()
+{
+    m_isStopping = false;
+    //the caller thread works as worker 0
+    for (int i = 1; i < m_threadsN; ++i)
+        m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i, m_jobToken));
+}
+
+void ThreadPool::Stop()
+{
+    if (m_workers.size() == 0)
+        return;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_jobCondition.notify_all();
+    for (unsigned int i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+    m_workers.clear();
+}
+
+void ThreadPool::WorkerLoop(int worker, int token)
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_isStopping && token == m_jobToken)
+                m_jobCondition.wait(lock);
+            if (m_isStopping)
+                return;
+            token = m_jobToken;
+        }
+        RunRange(worker);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (--m_busyN == 0)
+                m_doneCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunRange(int worker)
+{
+    //static partition : worker i always takes the i-th contiguous block
+    int size = m_end - m_begin;
+    int chunk = size / m_threadsN;
+    int rest = size % m_threadsN;
+    int first = m_begin + worker * chunk + std::min(worker, rest);
+    int last = first + chunk + (worker < rest ? 1 : 0);
+    try
+    {
+        for (int i = first; i < last; ++i)
+            m_callback->Invoke(i);
+    }
+    catch (...)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_exception)
+            m_exception = std::current_exception();
+    }
+}
+
+void ThreadPool::ParallelFor(const int& begin, const int& end, const Callback::Handle1<void, int>& callback)
+{
+    ASSERT(!callback.IsNull());
+    if (end <= begin)
+        return;
+    if (m_threadsN <= 1 || end - begin < m_threadsN)
+    {
+        for (int i = begin; i < end; ++i)
+            callback.Invoke(i);
+        return;
+    }
+    if ((int)m_workers.size() != m_threadsN - 1)
+        Start();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_begin = begin;
+        m_end = end;
+        m_callback = &callback;
+        m_exception = std::exception_ptr();
+        m_busyN = m_threadsN - 1;
+        ++m_jobToken;
+    }
+    m_jobCondition.notify_all();
+    RunRange(0);
+    std::exception_ptr exception;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_busyN > 0)
+            m_doneCondition.wait(lock);
+        m_callback = 0;
+        exception = m_exception;
+        m_exception = std::exception_ptr();
+    }
+    if (exception)
+        std::rethrow_exception(exception); //keep ASSERT semantic for the caller
+}
@@ -0,0 +1,54 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "callback.h"
+
+/*
+ * fixed size worker pool for data parallel loops
+ *   each index is handled exactly once, so the result does not depend on the number of threads
+ *   as long as the callback only writes to the slot of its own index
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(int threadsN = 0); //[0] means number of hardware threads
+    ~ThreadPool();
+
+    void SetThreadsN(int threadsN);
+    const int& GetThreadsN() const;
+
+    /* invoke callback for each index in [begin, end), return after all of them completed */
+    void ParallelFor(const int& begin, const int& end, const Callback::Handle1<void, int>& callback);
+
+private:
+    ThreadPool(const ThreadPool& o); //not copyable
+    ThreadPool& operator = (const ThreadPool& o);
+
+    void Start();
+    void Stop();
+    void WorkerLoop(int worker, int token); //[token] : the last job seen by this worker
+    void RunRange(int worker);
+
+    int m_threadsN;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_jobCondition;
+    std::condition_variable m_doneCondition;
+
+    /* current job, guarded by m_mutex */
+    bool m_isStopping;
+    int m_jobToken;
+    int m_busyN;
+    int m_begin;
+    int m_end;
+    const Callback::Handle1<void, int>* m_callback;
+    std::exception_ptr m_exception;
+
+};//class ThreadPool
+
+#endif